@@ -36,6 +36,7 @@ namespace DrawFunctor {
 	 	virtual void Action(const Rectangle& place_to_draw) = 0;
 	};
 
+	// All tiles are drawn with a single batch of quads
 	class TilingTexture : public Abstract {
 	 public:
 	 	TilingTexture() = delete;
@@ -47,6 +48,7 @@ namespace DrawFunctor {
 	 protected:
 	 	Texture* texture_;
 	 	Point2D<uint> offset_;
+	 	std::vector<TexturedQuad> quads_;
 	};
 
 	class ScalableTexture : public Abstract {
@@ -62,6 +64,40 @@ namespace DrawFunctor {
 	 	Point2D<uint> offset_;
 	};
 
+	// Frame cut from the borders of the frame texture (corners are kept,
+	// edges are stretched) around the center texture, which is scaled or
+	// tiled. Everything is drawn as one batch of quads with no overdraw,
+	// so when both textures are in the same atlas page it takes a single
+	// draw call.
+	class NineSliceTexture : public Abstract {
+	 public:
+	 	enum CenterMode {
+	 		kScalable,
+	 		kTiling
+	 	};
+
+	 	NineSliceTexture() = delete;
+	 	NineSliceTexture(Texture* frame,
+	 		               Texture* center,
+	 		               uint border_width,
+	 		               CenterMode center_mode);
+
+	 	void Action(const Rectangle& place_to_draw) override;
+
+	 protected:
+	 	Texture* frame_;
+	 	Texture* center_;
+	 	uint border_width_;
+	 	CenterMode center_mode_;
+	 	// parts of the frame texture for the 8 border quads, computed on
+	 	// first draw since the frame may be in a lazily packed atlas
+	 	Rectangle frame_slices_[8];
+	 	bool are_slices_computed_;
+	 	std::vector<TexturedQuad> quads_;
+
+	 	void ComputeFrameSlices();
+	};
+
 	class TextTexture : public Abstract {
 	 public:
 	 	TextTexture() = delete;
@@ -103,7 +139,8 @@ namespace Functor {
 
 	 	void SetWidgetToMove(Widget::Abstract* widget_to_move_);
 	 	void Action() override;
-	 	void SetShift(const Point2D<int>& shift);
+	 	// shifts added before the next Action are applied together
+	 	void AddShift(const Point2D<int>& shift);
 
 	 protected:
 	 	Widget::Abstract* widget_to_move_;
@@ -1,2 +1,6 @@
+#include <string>
+#include <vector>
 #include "Render.h"
-void RunApp(GLWindow* window, Render* render);
\ No newline at end of file
+// every PNG image or document of file_paths is opened in its own canvas
+void RunApp(GLWindow* window, Render* render,
+            const std::vector<std::string>& file_paths = {});
\ No newline at end of file
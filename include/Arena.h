@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include "main.h"
+
+// Owns objects that live exactly as long as something else, e.g. the
+// textures and functors of a window. They are constructed one after
+// another in big blocks and destroyed together, newest first, by Clear or
+// the destructor. Objects can't be deleted one by one.
+class Arena {
+ public:
+  static const size_t kDefaultBlockSize = 16 * 1024;
+
+  explicit Arena(size_t block_size = kDefaultBlockSize);
+  ~Arena();
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    T* object = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      void* memory = Allocate(sizeof(Destructor), alignof(Destructor));
+      destructors_ = new (memory) Destructor{&Destroy<T>, object, destructors_};
+    }
+    ++objects_count_;
+    return object;
+  }
+
+  // destroys all objects, the first block is kept for the next ones
+  void Clear();
+  size_t GetObjectsCount() const;
+
+ private:
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+  struct Destructor {
+    void (*destroy)(void*);
+    void* object;
+    Destructor* next;
+  };
+
+  size_t block_size_;
+  // the newest block first
+  Block* blocks_;
+  char* cur_;
+  char* end_;
+  Destructor* destructors_;
+  size_t objects_count_;
+
+  template <typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  void* Allocate(size_t size, size_t alignment);
+  void AddBlock(size_t min_size);
+
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <future>
+#include <string>
+#include <vector>
+#include "main.h"
+
+class Render;
+class Texture;
+class SDL_Texture;
+class SDL_Surface;
+
+// Packs skin images into a few large textures (pages), so that widgets
+// drawn with different skins sample from the same SDL_Texture.
+// Add starts decoding the image on the ThreadPool; Pack waits for the
+// decoding, packs the images and uploads the pages on the calling
+// (render) thread. An atlas that is never packed explicitly is packed on
+// the first use of any of its textures.
+class Atlas {
+ public:
+  Atlas() = delete;
+  Atlas(Render* render);
+  ~Atlas();
+
+  void Add(const char* image_name);
+  void Pack();
+  // returned texture is a view into a page, it must be deleted before the atlas
+  Texture* GetTexture(const char* image_name);
+  // packs the atlas if it isn't yet
+  SDL_Texture* GetImagePage(size_t image_index, Rectangle* region);
+  size_t GetPagesCount() const;
+
+ private:
+  struct Image {
+    std::string name;
+    std::future<SDL_Surface*> decoding;
+    SDL_Surface* surface;
+    size_t page;
+    Rectangle region;
+  };
+
+  Render* render_;
+  std::vector<Image> images_;
+  std::vector<SDL_Texture*> pages_;
+  bool is_packed_;
+
+  uint GetMaxPageSize() const;
+  void PlaceImages(std::vector<Point2D<uint>>* pages_sizes);
+  void UploadPages(const std::vector<Point2D<uint>>& pages_sizes);
+
+  Atlas(const Atlas&) = delete;
+  Atlas& operator=(const Atlas&) = delete;
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <string>
+#include <vector>
+#include "main.h"
+#include "Document.h"
+
+namespace Widget {
+  class Canvas;
+}
+
+// Keeps a snapshot document (kAutosaveDirName/canvas_<pid>_<n>.gdoc) of
+// every open canvas. Each period only tiles changed since the previous
+// snapshot are read back on the UI thread, compressing and writing them
+// runs on the ThreadPool. A snapshot of a canvas opened from a document
+// starts as a copy of it, so untouched tiles never have to be loaded.
+//
+// Snapshots of canvases closed with unsaved changes are kept, and so are
+// the ones of a crashed run: RecoverSnapshots moves them to
+// kDocumentsDirName on the next launch. At most one period of work is lost.
+class Autosaver {
+ public:
+  static Autosaver& GetInstance() {
+    static Autosaver instance;
+    return instance;
+  }
+
+  // Paths of snapshots left by runs that are over, moved to
+  // kDocumentsDirName as recovered_<pid>_<n>.gdoc
+  static std::vector<std::string> RecoverSnapshots();
+
+  void Add(Widget::Canvas* canvas);
+  // Called before the canvas is deleted. Its last changes are written if
+  // they aren't saved, otherwise the snapshot isn't needed anymore.
+  void Remove(Widget::Canvas* canvas);
+  // Starts snapshots of canvases changed since the previous period,
+  // called on the UI thread
+  void Tick(uint now_ms);
+  // Finishes snapshots written in the background, their jobs push a
+  // functor calling it to the FunctorQueue
+  void FinishWritten();
+  // waits for snapshots in progress
+  ~Autosaver();
+
+ private:
+  struct Entry {
+    Widget::Canvas* canvas;
+    std::string path;
+    // document the first snapshot is copied from, if any
+    std::string source_path;
+    // 0 until the first snapshot is started
+    uint width;
+    uint height;
+    // nullptr until the first snapshot is written
+    Document* snapshot;
+    bool is_failed;
+    uint64_t changes_count;
+    std::vector<Document::Tile> tiles;
+    std::future<bool> job;
+    // set by the job before it pushes the functor, the future may get
+    // ready a bit later than that
+    std::atomic<bool> is_written;
+  };
+
+  std::vector<Entry*> entries_;
+  uint snapshots_count_;
+  uint last_tick_ms_;
+
+  void StartSnapshot(Entry* entry);
+  // Runs on the ThreadPool
+  static bool WriteSnapshot(Entry* entry);
+  void FinishSnapshot(Entry* entry);
+
+  Autosaver();
+  Autosaver(const Autosaver&) = delete;
+  Autosaver& operator=(const Autosaver&) = delete;
+};
@@ -0,0 +1,15 @@
+#pragma once
+
+// Headless mode applying plugin filters to image files:
+//   ./out --batch -f Blur [-f <filter>]... -o <dir> [-j <threads>] <image>...
+// Every image goes through the filters in the given order and is saved
+// as <dir>/<image name>.png. Images are processed in parallel, every
+// worker has its own software render and its own instances of plugins.
+// Plugins not exporting IsCreateThreadSafe can't have several instances,
+// so a chain with their filters is run by one worker.
+namespace Batch {
+  static const char* kFlag = "--batch";
+
+  // args are the arguments following kFlag. Returns the exit code.
+  int Run(int argc, char** argv);
+}
@@ -1,5 +1,9 @@
 #include "Widget.h"
 #include "Plugin.h"
+#include "PngExport.h"
+#include "ImageImport.h"
+#include "Document.h"
+#include "Arena.h"
 
 namespace DrawFunctor {
   class PaletteButtonHighlight : public TilingTexture {
@@ -17,11 +21,11 @@ namespace Listener {
   class Canvas : public Abstract {
    public:
     Canvas() = delete;
-    Canvas(Widget::Canvas* canvas,
-           Plugin::Texture* painting_area,
-           Point2D<uint> mouse_coord);
+    Canvas(Widget::Canvas* canvas);
     ~Canvas() override = default;
 
+    // starts a stroke, called before the listener is added
+    void Begin(Point2D<uint> mouse_coord, uint64_t time_us);
     void ProcessSystemEvent(const SystemEvent& event) override;
 
    private:
@@ -39,9 +43,13 @@ namespace Widget {
   class Canvas : public Abstract {
    public:
     Canvas() = delete;
+    // The canvas is sized to fit the file at file_path: a document, whose
+    // tiles are loaded when they get into view, or a PNG, which is loaded
+    // in the background and shows up band by band
     Canvas(const Rectangle& position,
            Widget::MainWindow* main_window,
-           Render* render);
+           Render* render,
+           const char* file_path = nullptr);
     ~Canvas() override;
 
     void ProcessSystemEvent(const SystemEvent& event) override;
@@ -52,6 +60,15 @@ namespace Widget {
       return painting_area_;
     }
     Point2D<uint> GetViewPos();
+    // tiles of the document that haven't been shown yet, needed before
+    // working with the whole canvas (filters, export)
+    void LoadAllTiles();
+    // Saves to the canvas's document, a new one is created at path if the
+    // canvas has none. Only tiles changed since the last save are written.
+    bool SaveDocument(const std::string& path);
+    const Document* GetDocument() const;
+    // changed since it was opened or saved to its document
+    bool HasUnsavedChanges() const;
     friend Listener::Canvas;
 
    protected:
@@ -59,11 +76,18 @@ namespace Widget {
     uint area_width_;
     uint area_height_;
     Plugin::Texture* painting_area_;
-    Listener::Canvas* painting_listener_;
+    Listener::Canvas painting_listener_;
     Point2D<uint> view_pos_;
-
-    void StartPainting(Point2D<uint> mouse_coordinate);
+    // nullptr once the image is loaded
+    ImageImport* import_;
+    Document* document_;
+    std::vector<bool> loaded_tiles_;
+    // changes count of the painting area when it was last saved
+    uint64_t saved_changes_;
+
+    void StartPainting(Point2D<uint> mouse_coordinate, uint64_t time_us);
     void FinishPainting();
+    void LoadTiles(const Rectangle& region);
   };
 }
 
@@ -94,41 +118,99 @@ namespace Functor {
    public:
     ApplyFilter() = delete;
     ApplyFilter(Plugin::IFilter* filter,
-                Plugin::ITexture* canvas);
+                Widget::Canvas* canvas);
 
     // void SetToolButton(Widget::BasicButton* tool_button);
     void Action() override;
 
    protected:
     Plugin::IFilter* filter_;
-    Plugin::ITexture* canvas_;
+    Widget::Canvas* canvas_;
+  };
+
+  class ExportCanvas : public Abstract {
+   public:
+    ExportCanvas() = delete;
+    ExportCanvas(UserWidget::PaintWindow* paint_window);
+
+    void Action() override;
+
+   protected:
+    UserWidget::PaintWindow* paint_window_;
+  };
+
+  class SaveCanvas : public Abstract {
+   public:
+    SaveCanvas() = delete;
+    SaveCanvas(UserWidget::PaintWindow* paint_window);
+
+    void Action() override;
+
+   protected:
+    UserWidget::PaintWindow* paint_window_;
   };
 }
 
 namespace UserWidget {
-  class PaintWindow : public StandardWindow {
+  class PaintWindow : public StandardWindow, public Tool::PluginsObserver,
+                      public Png::ExportObserver {
    public:
     PaintWindow() = delete;
     PaintWindow(const Rectangle& pos,
                 Widget::MainWindow* main_window,
-                Render* render);
+                Render* render,
+                const char* file_path = nullptr);
     ~PaintWindow() override;
 
     void ProcessSystemEvent(const SystemEvent& event) override;
+    bool IsKeyboardFocusable() const override;
+    bool ProcessKey(const SystemEvent& event) override;
     void TogglePrefPanel(Plugin::ITool* tool);
+    void OnPluginsUnloading() override;
+    void OnPluginsLoaded() override;
+    // Saves the canvas to kExportsDirName in the background
+    void ExportCanvas();
+    // Saves the canvas to its document or to a new one in kDocumentsDirName
+    void SaveCanvas();
+    void OnExportFinished(const std::string& file_name, bool is_ok) override;
 
    private:
+    // textures, functors and dropdown lists of the window, child widgets
+    // are owned by their containers
+    Arena arena_;
+    // what is rebuilt when plugins are reloaded
+    Arena tools_arena_;
+    Widget::MainWindow* main_window_;
+    Render* render_;
+    Widget::Canvas* canvas_;
+    Widget::Container* palette_;
+    Point2D<int> palette_corner_;
+    // buttons of the window on the main bar
+    UserWidget::ButtonOnPressWithText* tools_button_;
+    UserWidget::ButtonOnPressWithText* colors_button_;
+    UserWidget::DropdownList* tools_list_;
+    UserWidget::DropdownList* colors_list_;
+    UserWidget::DropdownList* filters_list_;
     std::unordered_map<Plugin::ITool*, Plugin::IPreferencesPanel*> pref_panels_;
     Widget::AbstractContainer* cur_pref_panel_;
-    std::vector<Texture*> textures_to_free_;
-    std::vector<DrawFunctor::Abstract*> draw_funcs_to_free_;
-    std::vector<Functor::PickColor*> pick_color_funcs_to_free_;
-    std::vector<Functor::SetTool*> set_tool_funcs_to_free_;
+    std::vector<Widget::BasicButton*> color_buttons_;
     Functor::ScrollCanvas* scroll_canvas0_;
     Functor::ScrollCanvas* scroll_canvas1_;
+    Functor::ExportCanvas* export_canvas_;
+    Functor::SaveCanvas* save_canvas_;
+    // one export of a canvas at a time, each of them holds a copy of it
+    bool is_exporting_;
+    // entries of tools and filters, rebuilt when plugins are reloaded
+    std::vector<Widget::BasicButton*> tool_buttons_;
+    uint tools_rows_count_;
+    // keys acting on this window's canvas while it has the focus
+    ShortcutTable shortcuts_;
 
     void CreatePalette(Widget::Container* palette, Render* render,
                        const Point2D<int>& coord, Widget::MainWindow* main_window);
+    void CreateToolsAndFilters();
+    void DeleteToolsAndFilters();
+    void HidePrefPanel();
     Widget::BasicButton* CreateColorButton(Render* render, uint button_width,
                                            const Point2D<int>& coord, Widget::MainWindow* main_window, UserWidget::DropdownList* list);
     Widget::BasicButton* CreatePickToolButton(Plugin::ITool* tool, Render* render, uint button_width,
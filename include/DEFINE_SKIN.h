@@ -1,21 +1,21 @@
-DEFINE_SKIN (Scalable, HorizontalScrollBarNormal, "horizontal_scroll_bar_normal.png");
-DEFINE_SKIN (Scalable, HorizontalScrollBarHover,  "horizontal_scroll_bar_hover.png");
-DEFINE_SKIN (Scalable, HorizontalScrollBarClick,  "horizontal_scroll_bar_click.png");
-DEFINE_SKIN (Scalable, VerticalScrollBarNormal,   "vertical_scroll_bar_normal.png");
-DEFINE_SKIN (Scalable, VerticalScrollBarHover,    "vertical_scroll_bar_hover.png");
-DEFINE_SKIN (Scalable, VerticalScrollBarClick,    "vertical_scroll_bar_click.png");
-DEFINE_SKIN (Scalable, ButtonCloseNormal,         "button_close_normal.png");
-DEFINE_SKIN (Scalable, ButtonCloseHover,          "button_close_hover.png");
-DEFINE_SKIN (Scalable, ButtonHide,                "button_hide.png");
-DEFINE_SKIN (Scalable, IconFolder,                "icon_folder.png");
-DEFINE_SKIN (Scalable, IconWarning,               "icon_warning.png");
-DEFINE_SKIN (Tiling,   TexMainLightExtra,         "tex_main_light_extra.png");
-DEFINE_SKIN (Tiling,   TexMainLight,              "tex_main_light.png");
-DEFINE_SKIN (Tiling,   TexMain,                   "tex_main.png");
-DEFINE_SKIN (Tiling,   TexMainDark,               "tex_main_dark.png");
-DEFINE_SKIN (Tiling,   TexMainDarkExtra,          "tex_main_dark_extra.png");
-DEFINE_SKIN (Tiling,   TexStriped,                "tex_striped.png");
-DEFINE_SKIN (Tiling,   TexStripedLight,           "tex_striped_light.png");
-DEFINE_SKIN (Tiling,   TexWhite,                  "tex_white.png");
-DEFINE_SKIN (Tiling,   TexBlack,                  "tex_black.png");
-DEFINE_SKIN (Tiling,   TexTransparent,            "tex_transparent.png");
\ No newline at end of file
+DEFINE_SKIN (Scalable, HorizontalScrollBarNormal, "horizontal_scroll_bar_normal.png", Lazy );
+DEFINE_SKIN (Scalable, HorizontalScrollBarHover,  "horizontal_scroll_bar_hover.png",  Lazy );
+DEFINE_SKIN (Scalable, HorizontalScrollBarClick,  "horizontal_scroll_bar_click.png",  Lazy );
+DEFINE_SKIN (Scalable, VerticalScrollBarNormal,   "vertical_scroll_bar_normal.png",   Lazy );
+DEFINE_SKIN (Scalable, VerticalScrollBarHover,    "vertical_scroll_bar_hover.png",    Lazy );
+DEFINE_SKIN (Scalable, VerticalScrollBarClick,    "vertical_scroll_bar_click.png",    Lazy );
+DEFINE_SKIN (Scalable, ButtonCloseNormal,         "button_close_normal.png",          Lazy );
+DEFINE_SKIN (Scalable, ButtonCloseHover,          "button_close_hover.png",           Lazy );
+DEFINE_SKIN (Scalable, ButtonHide,                "button_hide.png",                  Lazy );
+DEFINE_SKIN (Scalable, IconFolder,                "icon_folder.png",                  Lazy );
+DEFINE_SKIN (Scalable, IconWarning,               "icon_warning.png",                 Lazy );
+DEFINE_SKIN (Tiling,   TexMainLightExtra,         "tex_main_light_extra.png",         Lazy );
+DEFINE_SKIN (Tiling,   TexMainLight,              "tex_main_light.png",               Eager);
+DEFINE_SKIN (Tiling,   TexMain,                   "tex_main.png",                     Eager);
+DEFINE_SKIN (Tiling,   TexMainDark,               "tex_main_dark.png",                Eager);
+DEFINE_SKIN (Tiling,   TexMainDarkExtra,          "tex_main_dark_extra.png",          Eager);
+DEFINE_SKIN (Tiling,   TexStriped,                "tex_striped.png",                  Lazy );
+DEFINE_SKIN (Tiling,   TexStripedLight,           "tex_striped_light.png",            Lazy );
+DEFINE_SKIN (Tiling,   TexWhite,                  "tex_white.png",                    Lazy );
+DEFINE_SKIN (Tiling,   TexBlack,                  "tex_black.png",                    Eager);
+DEFINE_SKIN (Tiling,   TexTransparent,            "tex_transparent.png",              Lazy );
\ No newline at end of file
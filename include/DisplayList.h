@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "main.h"
+
+class SDL_Renderer;
+class SDL_Texture;
+struct SDL_Vertex;
+
+// Screen draws of a frame, recorded while widgets draw and submitted to
+// the SDL_Renderer together before presenting. Consecutive quads sampling
+// the same SDL_Texture (an atlas page, a cached container) are submitted
+// with one SDL_RenderGeometry call even if different widgets drew them.
+// Memory is kept between frames, so recording doesn't allocate once the
+// lists have grown to the size of a frame.
+class DisplayList {
+ public:
+  DisplayList();
+  ~DisplayList();
+
+  // src is in pixels of the whole SDL_Texture, dst on the screen
+  void AddQuad(SDL_Texture* texture, const Rectangle& src, const Rectangle& dst);
+  // the texture is destroyed once submitted, e.g. rendered text
+  void AddOwnedCopy(SDL_Texture* texture, const Rectangle& dst);
+  void AddPoint(const Point2D<int>& point, const Color& color);
+  // fills the whole screen
+  void AddClear(const Color& color);
+
+  // Submits the draws to the screen and empties the list
+  void Submit(SDL_Renderer* render);
+
+  // Appends 4 vertices and the 6 indices, starting at base, of two
+  // triangles drawing src of a page_width x page_height texture to dst
+  static void AppendQuad(std::vector<SDL_Vertex>* vertices, std::vector<int>* indices,
+                         int base, const Rectangle& src, const Rectangle& dst,
+                         float page_width, float page_height);
+
+ private:
+  struct Command {
+    enum Kind {
+      kQuads,
+      kOwnedCopy,
+      kPoint,
+      kClear
+    };
+
+    Kind kind;
+    SDL_Texture* texture;
+    Color color;
+    // the destination of kOwnedCopy and kPoint
+    Rectangle rect;
+    // vertices_[first_vertex, first_vertex + vertices_count) and
+    // indices_[first_index, first_index + indices_count) for kQuads,
+    // indices are relative to first_vertex
+    size_t first_vertex;
+    size_t vertices_count;
+    size_t first_index;
+    size_t indices_count;
+  };
+
+  std::vector<Command> commands_;
+  std::vector<SDL_Vertex> vertices_;
+  std::vector<int> indices_;
+  // size of the texture of the last kQuads command, for texture coordinates
+  float page_width_;
+  float page_height_;
+
+  DisplayList(const DisplayList&) = delete;
+  DisplayList& operator=(const DisplayList&) = delete;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "main.h"
+
+// Canvas file (.gdoc): a header, tiles of kTileSize x kTileSize RGBA8888
+// pixels (the layout of Plugin::Texture) compressed one by one with zlib,
+// and a table with the place of every tile. The file is mapped to memory
+// and only requested tiles are decompressed.
+//
+// Saving never rewrites the file: new tiles and a new table are appended,
+// and the header then points at the new table. Every table keeps the
+// offset of the previous one, so earlier revisions stay readable and a
+// crash in the middle of a save leaves the last complete one in place.
+// Once the file is much bigger than its newest revision, it's rewritten
+// with that revision only.
+class Document {
+ public:
+  static const uint kTileSize = 256;
+  static const char* const kExtension;
+
+  struct Tile {
+    uint index;
+    // GetTileRect(index).width * height pixels
+    std::vector<uint> pixels;
+  };
+
+  // nullptr if the file can't be read or isn't a document
+  static Document* Open(const std::string& path);
+  // new document with all tiles transparent, nullptr on failure or if
+  // the file exists
+  static Document* Create(const std::string& path, uint width, uint height);
+  ~Document();
+
+  const std::string& GetPath() const;
+  uint GetWidth() const;
+  uint GetHeight() const;
+  uint GetTilesCount() const;
+  uint GetTilesCountX() const;
+  // part of the canvas covered by the tile
+  Rectangle GetTileRect(uint index) const;
+  // Decompresses the tile into pixels, tiles never saved are transparent.
+  // Returns false if the tile is damaged.
+  bool ReadTile(uint index, uint* pixels) const;
+  // Appends tiles (compressed in parallel on the ThreadPool unless
+  // in_parallel is false, e.g. when already running on it) and a table in
+  // which the other tiles keep their current data
+  bool Save(const std::vector<Tile>& tiles, bool in_parallel = true);
+
+ private:
+  struct Header;
+  struct TableHeader;
+  struct TileEntry {
+    uint64_t offset; // 0 for a transparent tile
+    uint32_t size;
+    uint32_t reserved;
+  };
+
+  std::string path_;
+  int fd_;
+  const unsigned char* mapping_;
+  size_t mapped_size_;
+  uint width_;
+  uint height_;
+  uint64_t table_offset_;
+  std::vector<TileEntry> table_;
+
+  Document(const std::string& path, int fd, uint width, uint height);
+  static bool WriteHeader(int fd, uint width, uint height, uint64_t table_offset);
+  bool Map();
+  bool ReadTable();
+  // bytes of the file used by the newest revision
+  uint64_t GetRevisionSize() const;
+  // Rewrites the file without earlier revisions, false if it's unchanged
+  bool Compact();
+
+  Document(const Document&) = delete;
+  Document& operator=(const Document&) = delete;
+};
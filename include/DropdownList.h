@@ -33,6 +33,8 @@ namespace UserWidget {
     ~DropdownList();
 
     void AddButton(ButtonInfo button);
+    // deletes all buttons, hides the list if it's shown
+    void Clear();
     void PopUp();
     void Hide();
     Point2D<int> Move(const Point2D<int>& shift,
@@ -52,7 +54,7 @@ namespace UserWidget {
     ButtonDrawInfo button_draw_info_;
     std::vector<BasicButtonWithText*> button_list_;
     bool is_visible_;
-    Listener::DropdownList* hover_listener_;
+    Listener::DropdownList hover_listener_;
     Functor::DropdownListClose* func_;
 
     void StartListeningMouseMotion();
@@ -1,37 +1,71 @@
 #pragma once
-#include <queue>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include "ActionFunctors.h"
 
+// Functors run by RunApp between frames, in the order they were pushed.
+// Any thread may push: the queue is a bounded lock-free ring with a
+// sequence number in every slot, and only the thread that created the
+// queue (the UI thread) pops. Pushing from another thread wakes RunApp if
+// it's waiting for events.
 class FunctorQueue {
  public:
+  static const size_t kCapacity = 1024;
+
   static FunctorQueue& GetInstance() {
   	static FunctorQueue instance;
     return instance;
   }
 
-  void Push(Functor::Abstract* func) {
-    queue_.push(func);
-  }
+  // Waits while the ring is full if called from a worker, the UI thread
+  // can't wait for itself and keeps extra functors aside instead
+  void Push(Functor::Abstract* func);
+  // Does nothing if func is already waiting to be popped, so it runs once
+  // per drain however many times it was pushed. Functors pushed this way
+  // keep their latest state themselves (a scroll position, an accumulated
+  // shift). UI thread only.
+  void PushCoalesced(Functor::Abstract* func);
+  // nullptr if the queue is empty, UI thread only
+  Functor::Abstract* Pop();
+  // Waits at most timeout_ms for an SDL event or a push from another
+  // thread, UI thread only
+  void WaitIdle(uint timeout_ms);
+  // interrupts WaitIdle without pushing anything
+  void Wake();
 
-  Functor::Abstract* Pop() {
-    Functor::Abstract* top = queue_.front();
-    queue_.pop();
-    return top;
-  }
-
-  bool IsEmpty() {
-    return queue_.empty();
-  }
+  void PrintStats() const;
 
   ~FunctorQueue() = default;
 
  private:
- 	std::queue<Functor::Abstract*> queue_;
+  struct Slot {
+    // pos when the slot is free for the push to pos, pos + 1 when it
+    // holds the functor pushed there
+    std::atomic<size_t> sequence;
+    Functor::Abstract* func;
+  };
+
+  Slot slots_[kCapacity];
+  alignas(64) std::atomic<size_t> push_pos_;
+  alignas(64) size_t pop_pos_;
+  std::thread::id owner_;
+  // pushed by the UI thread while the ring was full, popped after it
+  std::vector<Functor::Abstract*> overflow_;
+  // an SDL event is on its way, no need to push another one
+  std::atomic<bool> is_wake_pending_;
+  uint wake_event_type_;
+  // pushed by PushCoalesced and not popped yet, a handful at most
+  std::vector<Functor::Abstract*> coalesced_;
+  uint coalesced_pushes_;
+  uint merged_pushes_;
+
+  bool TryPush(Functor::Abstract* func);
 
-  FunctorQueue() = default;
+  FunctorQueue();
 
   FunctorQueue(const FunctorQueue&) = delete;
   FunctorQueue& operator=(const FunctorQueue&) = delete;
   FunctorQueue(FunctorQueue&&) = delete;
   FunctorQueue& operator=(FunctorQueue&&) = delete;
-};
\ No newline at end of file
+};
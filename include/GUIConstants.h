@@ -3,6 +3,9 @@
 static const char* kFontsDir = "fonts";
 static const char* kSkinsDirName = "skins";
 static const char* kPluginsDirName = "plugins";
+static const char* kExportsDirName = "exports";
+static const char* kDocumentsDirName = "documents";
+static const char* kAutosaveDirName = "autosave";
 
 // static const char* kFontName = "OpenSans-Bold.ttf";
 static const char* kFontName = "OpenSans-Light.ttf";
@@ -0,0 +1,65 @@
+#pragma once
+#include "IPlugin.h"
+
+// Widgets for running plugins where nobody sees their preferences panels
+// (sandbox child, batch mode): plugins create them as usual, they are
+// never shown and sliders keep their values for GetValue
+namespace Headless {
+  struct Button : public Plugin::IButton {
+    uint GetWidth() override {return 0;}
+    uint GetHeight() override {return 0;}
+    void SetClickCallback(Plugin::IClickCallback* callback) override {}
+  };
+
+  struct Slider : public Plugin::ISlider {
+    explicit Slider(float value) : value_(value) {}
+    uint GetWidth() override {return 0;}
+    uint GetHeight() override {return 0;}
+    void SetSliderCallback(Plugin::ISliderCallback* callback) override {}
+    float GetValue() override {return value_;}
+    void SetValue(float value) override {value_ = value;}
+    float value_;
+  };
+
+  struct Label : public Plugin::ILabel {
+    uint GetWidth() override {return 0;}
+    uint GetHeight() override {return 0;}
+    void SetText(const char* text) override {}
+  };
+
+  struct Icon : public Plugin::IIcon {
+    uint GetWidth() override {return 0;}
+    uint GetHeight() override {return 0;}
+    void SetIcon(const Plugin::ITexture* icon) override {}
+  };
+
+  struct Palette : public Plugin::IPalette {
+    uint GetWidth() override {return 0;}
+    uint GetHeight() override {return 0;}
+    void SetPaletteCallback(Plugin::IPaletteCallback* callback) override {}
+  };
+
+  struct PreferencesPanel : public Plugin::IPreferencesPanel {
+    uint GetWidth() override {return 0;}
+    uint GetHeight() override {return 0;}
+    void Attach(Plugin::IButton*  button,  int x, int y) override {}
+    void Attach(Plugin::ILabel*   label,   int x, int y) override {}
+    void Attach(Plugin::ISlider*  slider,  int x, int y) override {}
+    void Attach(Plugin::IIcon*    icon,    int x, int y) override {}
+    void Attach(Plugin::IPalette* palette, int x, int y) override {}
+  };
+
+  struct WidgetFactory : public Plugin::IWidgetFactory {
+    Plugin::IButton* CreateDefaultButtonWithIcon(const char* icon_file_name) override {return new Button;}
+    Plugin::IButton* CreateDefaultButtonWithText(const char* text) override {return new Button;}
+    Plugin::IButton* CreateButtonWithIcon(uint width, uint height, const char* icon_file_name) override {return new Button;}
+    Plugin::IButton* CreateButtonWithText(uint width, uint height, const char* text, uint char_size) override {return new Button;}
+    Plugin::ISlider* CreateDefaultSlider(float range_min, float range_max) override {return new Slider(range_min);}
+    Plugin::ISlider* CreateSlider(uint width, uint height, float range_min, float range_max) override {return new Slider(range_min);}
+    Plugin::ILabel* CreateDefaultLabel(const char* text) override {return new Label;}
+    Plugin::ILabel* CreateLabel(uint width, uint height, const char* text, uint char_size) override {return new Label;}
+    Plugin::IIcon* CreateIcon(uint width, uint height) override {return new Icon;}
+    Plugin::IPalette* CreatePalette() override {return new Palette;}
+    Plugin::IPreferencesPanel* CreatePreferencesPanel() override {return new PreferencesPanel;}
+  };
+}
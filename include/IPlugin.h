@@ -195,6 +195,10 @@ struct IPlugin {
 typedef IPlugin* (*CreateFunction) (IAPI* api);
 typedef void     (*DestroyFunction)(IPlugin* plugin);
 typedef uint (*VersionFunction)();
+// Optional export: a plugin returning true promises that its Create
+// doesn't use the IAPI, so it may be called outside of the UI thread
+// concurrently with other plugins
+typedef bool (*IsCreateThreadSafeFunction)();
 
 #ifdef _WIN32 //windows
 
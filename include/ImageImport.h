@@ -0,0 +1,52 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "main.h"
+
+namespace Plugin {
+  class Texture;
+}
+
+// Loads a PNG into a canvas without stalling the UI: rows are decoded in
+// bands on the ThreadPool and every band is uploaded as soon as it's
+// ready, so the top of a big scan shows up long before the bottom.
+class ImageImport {
+ public:
+  // Reads only the header. Returns false if the file isn't a readable PNG.
+  static bool ReadSize(const char* file_name, uint* width, uint* height);
+
+  ImageImport() = delete;
+  // canvas must be at least as big as the image
+  ImageImport(const std::string& file_name, Plugin::Texture* canvas);
+  // Uploads bands decoded since the last call, UI thread only
+  void UploadDecoded();
+  // true once everything is decoded and uploaded (or decoding failed)
+  bool IsFinished();
+  // stops decoding if it's still in progress
+  ~ImageImport();
+
+ private:
+  struct Band {
+    uint first_row;
+    uint rows_count;
+    uint width;
+    std::vector<uint> pixels;
+  };
+
+  std::string file_name_;
+  Plugin::Texture* canvas_;
+  std::mutex mutex_;
+  std::vector<Band> decoded_;
+  std::atomic<bool> is_cancelled_;
+  std::future<bool> is_decoded_;
+  bool is_finished_;
+
+  bool Decode();
+  void PushBand(Band&& band);
+
+  ImageImport(const ImageImport&) = delete;
+  ImageImport& operator=(const ImageImport&) = delete;
+};
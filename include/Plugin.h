@@ -20,6 +20,12 @@ namespace Plugin {
     Buffer ReadBuffer() override;
     void ReleaseBuffer(Buffer buffer) override;
     void LoadBuffer(Buffer buffer) override;
+    // RGBA8888 pixels, the same layout ReadBuffer gives
+    void ReadPixels(Color* pixels);
+    void ReadPixels(Color* pixels, const Rectangle& region);
+    void WritePixels(const Color* pixels);
+    // pixels of region only, rows of region.width pixels
+    void WritePixels(const Color* pixels, const Rectangle& region);
 
     void Clear(Color Color) override;
     void Present() override {}
@@ -31,11 +37,34 @@ namespace Plugin {
     void CopyTexture(ITexture* source, int x, int y, uint width, uint height) override;
     void CopyTexture(ITexture* source, int x, int y) override;
     void Draw(const Rectangle& position, const Point2D<int>& src = {});
+    // saves to file_name.png
+    bool SaveToPNG(const char* file_name);
+
+    // Drawing through ITexture and WritePixels of the whole texture mark
+    // the tiles they touch as changed, for incremental saves
+    void TrackChangedTiles(uint tile_size);
+    void MarkChanged(const Rectangle& region);
+    // marks the tiles only, the changes count stays, e.g. for content
+    // loaded from a file that still has it
+    void MarkTilesChanged(const Rectangle& region);
+    // indices (row by row) of tiles changed since the previous call
+    std::vector<uint> TakeChangedTiles();
+    // Indices of tiles changed since MarkTilesSaved, tracked apart from
+    // TakeChangedTiles: snapshots and saves happen at different times
+    std::vector<uint> GetUnsavedTiles() const;
+    void MarkTilesSaved();
+    // grows with every change, tracked or not
+    uint64_t GetChangesCount() const;
     friend class Icon;
 
    private:
     ::Texture texture_;
     Render* render_;
+    uint tile_size_; // 0 if tiles aren't tracked
+    uint tiles_count_x_;
+    std::vector<bool> changed_tiles_;
+    std::vector<bool> unsaved_tiles_;
+    uint64_t changes_count_;
   };
 
   class TextureFactory : public ITextureFactory {
@@ -187,6 +216,9 @@ namespace Plugin {
 
     std::vector<Palette*> GetPalettes() {return palettes_;}
     void AddPalette(Palette* p) {palettes_.push_back(p);}
+    // drops palettes whose callbacks are implemented in the shared library
+    // containing library_address, called before the library is unloaded
+    void ForgetPalettesOf(const void* library_address);
 
    private:
     std::vector<::Texture*> textures_to_free_;
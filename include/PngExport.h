@@ -0,0 +1,63 @@
+#pragma once
+#include <atomic>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include "main.h"
+
+namespace Plugin {
+  class Texture;
+}
+
+namespace Png {
+  // pixels are RGBA8888 as SDL_RenderReadPixels gives them. Rows are
+  // converted and compressed one at a time, the whole image is never
+  // copied. Returns false if the file can't be written.
+  bool Write(const char* file_name, const uint* pixels,
+             uint width, uint height);
+
+  class ExportObserver {
+   public:
+    virtual ~ExportObserver() = default;
+    virtual void OnExportFinished(const std::string& file_name, bool is_ok) = 0;
+  };
+
+  // Saves textures without stalling the UI: only the readback happens on
+  // the UI thread, encoding and writing run on the ThreadPool
+  class Exporter {
+   public:
+    static Exporter& GetInstance() {
+      static Exporter instance;
+      return instance;
+    }
+
+    // texture may be changed or deleted right after the call
+    void Export(Plugin::Texture* texture, const std::string& file_name,
+                ExportObserver* observer = nullptr);
+    // Notifies observers of finished exports. Jobs push a functor calling
+    // it to the FunctorQueue when they finish.
+    void DeliverFinished();
+    // observer won't be notified anymore, e.g. it's being deleted
+    void ForgetObserver(ExportObserver* observer);
+    bool IsExporting() const;
+    // waits for exports in progress
+    ~Exporter();
+
+   private:
+    struct Job {
+      std::string file_name;
+      ExportObserver* observer;
+      std::future<bool> is_ok;
+      // set before the functor is pushed, the future may get ready a bit
+      // later than that
+      std::shared_ptr<std::atomic<bool>> is_finished;
+    };
+
+    std::vector<Job> jobs_;
+
+    Exporter();
+    Exporter(const Exporter&) = delete;
+    Exporter& operator=(const Exporter&) = delete;
+  };
+}
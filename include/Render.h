@@ -1,5 +1,7 @@
 #pragma once
+#include <vector>
 #include "main.h"
+#include "DisplayList.h"
 
 class Texture;
 class GLWindow;
@@ -15,6 +17,9 @@ namespace Plugin {
 class Render {
  public:
  	Render(const GLWindow& window);
+  // Software renderer drawing to surface, needs neither a window nor the
+  // video subsystem. Has no font, so it can't draw text.
+  explicit Render(SDL_Surface* surface);
  	SDL_Renderer* GetRender() const;
  	_TTF_Font* GetFont() const;
   void DrawText(const char* text_str,
@@ -24,12 +29,34 @@ class Render {
                  const Color& color = {});
 	void SetBackgroundColor(const Color& color);
 	SDL_Texture* CreateTextureFromSurface(SDL_Surface* surface);
+  // Everything drawn "to the screen" (Texture::Draw, DrawText...) goes to
+  // the target on top of the stack instead, with origin as its (0, 0)
+  void PushTarget(Texture* target, const Point2D<int>& origin);
+  void PopTarget();
+  // Between these, draws to the screen itself are recorded into a
+  // DisplayList and submitted by EndFrame, draws to other targets still
+  // happen right away
+  void BeginFrame();
+  void EndFrame();
   ~Render();
 
   friend class Texture;
   friend class Plugin::Texture;
 
  private:
+  struct Target {
+    SDL_Texture* texture;
+    Point2D<int> origin;
+  };
+
  	SDL_Renderer* render_ = nullptr;
 	_TTF_Font* font_ = nullptr;
+  std::vector<Target> targets_;
+  DisplayList frame_;
+  bool is_recording_ = false;
+
+  // nullptr if screen draws must be submitted right away
+  DisplayList* GetFrameList();
+  void SetScreenTarget();
+  Point2D<int> GetScreenOrigin() const;
 };
\ No newline at end of file
@@ -0,0 +1,74 @@
+#pragma once
+#include <string>
+#include <sys/types.h>
+#include "IPlugin.h"
+
+// Isolation mode for plugin filters (--sandbox-filters): filters run in a
+// child process, so a crashing or hanging filter can't take the app down.
+// Canvas pixels are passed through a memfd mapping shared by both
+// processes, the child works on them in place.
+namespace Sandbox {
+  static const char* kChildFlag = "--sandbox-child";
+  static const char* kEnableFlag = "--sandbox-filters";
+
+  // Main loop of the child process, socket_fd is its end of the socket
+  // pair created by Host. Returns the exit code.
+  int RunChild(int socket_fd);
+
+  class Host {
+   public:
+    static Host& GetInstance() {
+      static Host instance;
+      return instance;
+    }
+
+    void Enable();
+    bool IsEnabled() const;
+    // Shared buffer of at least width * height pixels, nullptr if it
+    // can't be allocated
+    Plugin::Color* GetPixels(uint width, uint height);
+    // Applies filter_index-th filter of the plugin to the shared buffer.
+    // Returns false if the filter failed, crashed or timed out, the child
+    // is restarted in the last two cases.
+    bool Apply(const std::string& plugin_path, uint filter_index,
+               uint width, uint height);
+    // Child loads plugins once, it must be restarted after they change
+    void Restart();
+    ~Host();
+
+   private:
+    bool is_enabled_;
+    pid_t child_;
+    int socket_;
+    int memfd_;
+    Plugin::Color* pixels_;
+    size_t mapped_size_;
+
+    Host();
+    bool Spawn();
+    void Kill();
+    bool SendRequest(const std::string& plugin_path, uint filter_index,
+                     uint width, uint height);
+
+    Host(const Host&) = delete;
+    Host& operator=(const Host&) = delete;
+  };
+
+  // Stands in the UI for a plugin filter, Apply runs the copy of the
+  // filter living in the child process
+  class Filter : public Plugin::IFilter {
+   public:
+    Filter() = delete;
+    Filter(Plugin::IFilter* filter, const std::string& plugin_path,
+           uint filter_index);
+
+    void Apply(Plugin::ITexture* canvas) override;
+    const char* GetName() const override;
+    Plugin::IPreferencesPanel* GetPreferencesPanel() const override;
+
+   private:
+    Plugin::IFilter* filter_;
+    std::string plugin_path_;
+    uint filter_index_;
+  };
+}
@@ -17,21 +17,15 @@ namespace Listener {
   class Scroll : public Abstract {
    public:
     Scroll() = delete;
-    Scroll(Functor::Scroll* scroll_func,
-           Widget::Scroll* widget_scroll,
-           ScrollType scroll_type,
-           int bound0,
-           int bound1);
+    // the scroll function, type and bounds are read from widget_scroll, so
+    // SetBound0 and SetBound1 apply to a scroll in progress too
+    Scroll(Widget::Scroll* widget_scroll);
     ~Scroll() override = default;
 
     void ProcessSystemEvent(const SystemEvent& event) override;
 
    private:
-    Functor::Scroll* scroll_func_;
     Widget::Scroll* widget_scroll_;
-    ScrollType scroll_type_;
-    int bound0_;
-    int bound1_;
   };
 }
 
@@ -63,8 +57,8 @@ namespace Widget {
     int bound1_;
     Functor::Scroll* scroll_func_;
     ButtonDrawFunctors draw_funcs_;
-    Listener::ScrollHover* hover_listener_;
-    Listener::Scroll* scroll_listener_;
+    Listener::ScrollHover hover_listener_;
+    Listener::Scroll scroll_listener_;
     
     void StartHovering();
     void StopHovering();
@@ -0,0 +1,26 @@
+#pragma once
+#include "SystemEvents.h"
+#include "ActionFunctors.h"
+
+// Functors bound to keys with modifiers. Looking a key up is a single
+// array access, so every key press can be checked against several tables.
+class ShortcutTable {
+ public:
+  // SDL_NUM_SCANCODES, checked where SDL is included
+  static const uint kScancodesCount = 512;
+
+  ShortcutTable();
+
+  // modifiers are KeyboardKeyClickInfo::Modifier bits, the functor bound
+  // to the same key before is replaced
+  void Bind(int scancode, uint modifiers, Functor::Abstract* func);
+  void Unbind(int scancode, uint modifiers);
+  // nullptr if nothing is bound to the key
+  Functor::Abstract* Find(const KeyboardKeyClickInfo& key) const;
+
+ private:
+  Functor::Abstract* table_[kScancodesCount][KeyboardKeyClickInfo::kModifiersCount];
+
+  ShortcutTable(const ShortcutTable&) = delete;
+  ShortcutTable& operator=(const ShortcutTable&) = delete;
+};
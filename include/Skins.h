@@ -1,7 +1,7 @@
 #pragma once
-#define DEFINE_SKIN(Scalability, Name, file_name)     \
+#define DEFINE_SKIN(Scalability, Name, file_name, Loading) \
   extern Texture* kTexture##Name;                            \
   extern DrawFunctor::Scalability##Texture* kFuncDraw##Name; \
-  extern DrawFunctor::MultipleFunctors* kFuncDraw##Name##Framed;
+  extern DrawFunctor::NineSliceTexture* kFuncDraw##Name##Framed;
   #include "../include/DEFINE_SKIN.h"
 #undef DEFINE_SKIN
\ No newline at end of file
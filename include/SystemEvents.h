@@ -1,8 +1,25 @@
 #pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
 #include "main.h"
 
+union SDL_Event;
+
 struct KeyboardKeyClickInfo {
+  enum Modifier {
+    kShift = 1,
+    kCtrl  = 2,
+    kAlt   = 4
+  };
+  static const uint kModifiersCount = 8;
+
   int scancode = 0;
+  // Modifier bits, left and right keys aren't told apart
+  uint modifiers = 0;
+  // sent again because the key is held
+  bool is_repeat = false;
 };
 
 struct MouseClickInfo {
@@ -17,6 +34,8 @@ struct MouseClickInfo {
 struct MouseMotionInfo {
   Point2D<uint> old_mouse_pos = {0, 0};
   Point2D<uint> new_mouse_pos = {0, 0};
+  // strokes and drags need every motion, hovering only the last one
+  bool is_button_pressed = false;
 };
 
 struct WindowResizeInfo {
@@ -46,6 +65,100 @@ struct SystemEvent {
 
   Type type;
   Info info;
+  // when SDL received the event, not when it's dispatched
+  uint64_t time_us;
 };
 
-bool IsSomeEventInQueue(SystemEvent* event);
\ No newline at end of file
+// Filters run over the events of a frame before they are dispatched. They
+// may drop and merge events in place, but never add any.
+namespace EventFilter {
+  class Abstract {
+   public:
+    virtual ~Abstract() = default;
+    // events[0, *count) is the batch, *count is updated
+    virtual void Apply(SystemEvent* events, size_t* count) = 0;
+  };
+
+  // Merges runs of motions made with no button pressed into one motion
+  class CoalesceMotion : public Abstract {
+   public:
+    void Apply(SystemEvent* events, size_t* count) override;
+  };
+
+  // Keeps only the last resize of each window
+  class DropStaleResizes : public Abstract {
+   public:
+    void Apply(SystemEvent* events, size_t* count) override;
+  };
+
+  // Appends every event to a file as a frame number followed by the raw
+  // SystemEvent, readable by the same build only
+  class Record : public Abstract {
+   public:
+    Record() = delete;
+    explicit Record(FILE* file);
+    ~Record();
+    void Apply(SystemEvent* events, size_t* count) override;
+
+   private:
+    FILE* file_;
+    uint frame_;
+  };
+}
+
+// Collects all pending SDL events of a frame into a preallocated batch,
+// runs the filters over it, and only then they are dispatched, so a burst
+// of input costs no allocations and no dispatching of stale events.
+//
+// Events are converted and timestamped by an SDL event watch as soon as
+// SDL receives them, and wait for Collect in a lock-free ring. SDL reads
+// window input only on the thread that pumps events, so RunApp pumps in
+// the middle of long frames too.
+class EventPump {
+ public:
+  static const size_t kCapacity = 256;
+  static const size_t kInputCapacity = 1024;
+  static constexpr const char* kRecordFlag = "--record-events";
+
+  static EventPump& GetInstance() {
+    static EventPump instance;
+    return instance;
+  }
+
+  // Installs the event watch, SDL must be initialized
+  void Start();
+  // Lets SDL read pending input, so it gets timestamped now rather than
+  // at the end of the frame. UI thread only.
+  void PumpInput();
+  // Replaces the previous batch, events past kCapacity are left in the
+  // ring for the next frame. Returns the number of events in the batch.
+  size_t Collect();
+  const SystemEvent* GetEvents() const;
+  // filters run in the order they were added, recording sees raw events
+  void AddFilter(EventFilter::Abstract* filter);
+  void StartRecording(const char* path);
+
+  ~EventPump();
+
+ private:
+  SystemEvent events_[kCapacity];
+  size_t count_;
+  std::vector<EventFilter::Abstract*> filters_;
+  EventFilter::Record* record_;
+  EventFilter::CoalesceMotion coalesce_motion_;
+  EventFilter::DropStaleResizes drop_stale_resizes_;
+  // written by the watch, read by Collect
+  SystemEvent input_[kInputCapacity];
+  alignas(64) std::atomic<size_t> input_push_pos_;
+  alignas(64) std::atomic<size_t> input_pop_pos_;
+  uint64_t counter_frequency_;
+
+  EventPump();
+  // called by SDL for every event it queues, on the thread queuing it
+  static int Watch(void* pump, SDL_Event* sdl_event);
+
+  EventPump(const EventPump&) = delete;
+  EventPump& operator=(const EventPump&) = delete;
+  EventPump(EventPump&&) = delete;
+  EventPump& operator=(EventPump&&) = delete;
+};
\ No newline at end of file
@@ -1,16 +1,32 @@
 #pragma once
+#include <vector>
 #include "main.h"
 class Render;
+class Atlas;
 class SDL_Texture;
 
 namespace Plugin {
   class Texture;
 }
 
+class Texture;
+
+// Part of a texture (src is relative to the texture, like in Draw) and
+// the place on the screen to stretch it to
+struct TexturedQuad {
+  const Texture* texture;
+  Rectangle src;
+  Rectangle dst;
+};
+
 class Texture {
  public:
   Texture() = delete;
  	Texture(const char* image_name, Render* render);
+  // View of a region of a texture owned by someone else (e.g. an Atlas page)
+  Texture(SDL_Texture* texture, const Rectangle& region, Render* render);
+  // View of an image of an atlas that isn't packed yet, resolved on first use
+  Texture(Atlas* atlas, size_t image_index, Render* render);
   Texture(const char* text, Render* render, const Color& color);
   Texture(uint width, uint height, Render* render, const Color& color = {});
   Texture(const Texture& texture);
@@ -20,6 +36,9 @@ class Texture {
             const Rectangle* dst);
   void DrawWithNoScale(const Rectangle* dst,
                        const Point2D<int>& src = {});
+  // Draws quads to the screen with one SDL_RenderGeometry call per run of
+  // consecutive quads sampling the same SDL_Texture (e.g. an atlas page)
+  static void DrawQuads(const std::vector<TexturedQuad>& quads);
   void DrawLine(const Point2D<int>& coordinates1,
                 const Point2D<int>& coordinates2,
                 const Color& color = {});
@@ -36,16 +55,35 @@ class Texture {
   void DrawText(const char* text_str,
                 const Point2D<int>& dest_coord,
                 const Color& color);
+  // fills the texture with transparent pixels regardless of blend mode
+  void Clear();
   void SetBackgroundColor(const Color& color);
-  void SaveToPNG(const char* file_name);
+  // false if the file can't be written
+  bool SaveToPNG(const char* file_name);
   uint GetWidth() const;
   uint GetHeight() const;
  	friend class Render;
   friend class Plugin::Texture;
 
  private:
- 	SDL_Texture* texture_;
+ 	enum Ownership {
+    kOwned,
+    kShared,  // owned by TextureCache and shared between its users
+    kBorrowed // a region of a texture owned by someone else
+  };
+
+  // texture_ and its region are filled in on first use for textures of
+  // an atlas that isn't packed yet (see Resolve)
+ 	mutable SDL_Texture* texture_;
   Render* render_;
-  uint width_;
-  uint height_;
+  Ownership ownership_;
+  // corner of the texture's region inside texture_, all source
+  // rectangles are relative to it
+  mutable Point2D<int> origin_;
+  mutable uint width_;
+  mutable uint height_;
+  Atlas* atlas_;
+  size_t atlas_image_;
+
+  void Resolve() const;
 };
\ No newline at end of file
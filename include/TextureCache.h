@@ -0,0 +1,65 @@
+#pragma once
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "main.h"
+
+class Render;
+class SDL_Texture;
+
+// Shares textures loaded from image files between all their users.
+// Every Acquire must be paired with a Release, the texture is destroyed
+// when its last user releases it.
+class TextureCache {
+ public:
+  struct Entry {
+    SDL_Texture* texture = nullptr;
+    uint width = 0;
+    uint height = 0;
+    uint ref_count = 0;
+  };
+
+  static TextureCache& GetInstance() {
+    static TextureCache instance;
+    return instance;
+  }
+
+  const Entry& Acquire(const char* image_path, Render* render);
+  void Release(SDL_Texture* texture);
+
+  uint GetHits() const;
+  uint GetMisses() const;
+  size_t GetSize() const;
+  void PrintStats() const;
+
+  ~TextureCache() = default;
+
+ private:
+  struct Key {
+    std::string path;
+    Render* render;
+    bool operator==(const Key& key) const {
+      return render == key.render && path == key.path;
+    }
+  };
+
+  struct KeyHash {
+    size_t operator()(const Key& key) const {
+      return std::hash<std::string>()(key.path) ^ std::hash<Render*>()(key.render);
+    }
+  };
+
+  std::unordered_map<Key, Entry, KeyHash> entries_;
+  std::unordered_map<SDL_Texture*, Key> keys_;
+  uint hits_ = 0;
+  uint misses_ = 0;
+  // batch mode acquires textures from several threads, each with its own render
+  mutable std::mutex mutex_;
+
+  TextureCache() = default;
+
+  TextureCache(const TextureCache&) = delete;
+  TextureCache& operator=(const TextureCache&) = delete;
+  TextureCache(TextureCache&&) = delete;
+  TextureCache& operator=(TextureCache&&) = delete;
+};
@@ -0,0 +1,52 @@
+#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads executing submitted jobs in FIFO order.
+// Jobs must not touch SDL_Renderer or widgets, those live on the UI thread.
+class ThreadPool {
+ public:
+  // shared pool for background work with one thread per core
+  static ThreadPool& GetInstance() {
+    static ThreadPool instance(0);
+    return instance;
+  }
+
+  // threads_count = 0 means one thread per core
+  explicit ThreadPool(size_t threads_count);
+  // finishes already submitted jobs
+  ~ThreadPool();
+
+  template <typename Func>
+  auto Submit(Func func) -> std::future<decltype(func())> {
+    using Result = decltype(func());
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+    std::future<Result> result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push([task]() { (*task)(); });
+    }
+    cond_.notify_one();
+    return result;
+  }
+
+  size_t GetThreadsCount() const;
+
+ private:
+  std::vector<std::thread> workers_;
+  std::queue<std::function<void()>> jobs_;
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool is_stopping_;
+
+  void WorkerLoop();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+};
@@ -1,34 +1,90 @@
 #pragma once
 #include "main.h"
 #include "IPlugin.h"
+#include <future>
 #include <list>
+#include <string>
+#include <vector>
 
 namespace Tool {
+	// Gets notified when plugins are reloaded: everything referring to the
+	// old tools and filters must be dropped in OnPluginsUnloading and may
+	// be rebuilt from the manager's lists in OnPluginsLoaded
+	class PluginsObserver {
+	 public:
+	 	virtual ~PluginsObserver() = default;
+	 	virtual void OnPluginsUnloading() = 0;
+	 	virtual void OnPluginsLoaded() = 0;
+	};
+
+	// Besides the builtin tools, owns all plugins found in kPluginsDirName.
+	// The libraries are opened in the background when the manager is
+	// created; plugins are instantiated on the first request of the tools
+	// or filters list. A changed .so is reloaded while the app is running.
 	class Manager {
 	 public:
+	 	struct PluginLib {
+	 		std::string path;
+	 		void* handle;
+	 		Plugin::CreateFunction create;
+	 		Plugin::DestroyFunction destroy;
+	 		bool is_create_thread_safe;
+	 		Plugin::IPlugin* plugin;
+	 	};
+
+	 	// Paths of all .so files in kPluginsDirName, sorted
+	 	static std::vector<std::string> FindPlugins();
+	 	// dlopen and the version check, safe to call from any thread.
+	 	// Returns a lib with handle == nullptr if the plugin can't be used.
+	 	static PluginLib OpenPlugin(const std::string& path);
+
 	  static Manager* GetInstance();
-	  void ActionBegin(Plugin::ITexture* canvas, Point2D<int> point);
-    void Action(Plugin::ITexture* canvas, Point2D<int> prev_point, Point2D<int> diff);
+	  // time_us is when the input event was received, see SystemEvent
+	  void ActionBegin(Plugin::ITexture* canvas, Point2D<int> point, uint64_t time_us);
+    void Action(Plugin::ITexture* canvas, Point2D<int> prev_point, Point2D<int> diff, uint64_t time_us);
     void ActionEnd(Plugin::ITexture* canvas, Point2D<int> point);
 	  uint GetThickness();
+	  // Pixels per second of the current stroke, smoothed over its last
+	  // motions. Pencil thins with it, brushes without pressure may too.
+	  float GetStrokeVelocity();
 	  uint GetColor();
 	  std::list<Plugin::ITool*>& GetToolsList();
 	  std::list<Plugin::IFilter*>& GetFiltersList();
 	  void SetColor(const Color& color);
 	  void SetCurrentTool(Plugin::ITool* tool);
+	  void AddObserver(PluginsObserver* observer);
+	  void DeleteObserver(PluginsObserver* observer);
+	  // Reloads plugins whose files were changed since the last call, must
+	  // be called on the UI thread while no tool or filter is running
+	  void ReloadChangedPlugins();
   	~Manager();
 
 	 private:
 	 	uint thickness_;
 	 	Color color_;
+	 	uint64_t stroke_time_us_;
+	 	// moved since stroke_time_us_, motions may share a timestamp
+	 	float stroke_distance_;
+	 	float stroke_velocity_;
 	 	std::list<Plugin::ITool*> tools_;
 	 	std::list<Plugin::IFilter*> filters_;
+	 	// wrappers owned by the manager when filters are sandboxed
+	 	std::vector<Plugin::IFilter*> sandboxed_filters_;
+	 	std::vector<Plugin::ITool*> builtin_tools_;
 	 	Plugin::ITool* cur_tool_;
-	 	void* plugin_lib_;
-	 	Plugin::IPlugin* plugin_;
+	 	std::vector<std::future<PluginLib>> opening_libs_;
+	 	std::vector<PluginLib> libs_;
+	 	bool are_plugins_created_;
+	 	int inotify_fd_;
+	 	std::vector<PluginsObserver*> observers_;
 
 	  Manager();
 	  void Init();
+	  void WatchPluginsDir();
+	  void CreatePlugins();
+	  void FillLists();
+	  void UnloadPlugin(const PluginLib& lib);
+	  void ReloadPlugin(const std::string& path);
 	  Manager(const Manager&) = delete;
 	  Manager& operator=(const Manager&) = delete;
 	  Manager(Manager&&) = delete;
@@ -8,12 +8,26 @@
 #include "ActionFunctors.h"
 #include "FunctorQueue.h"
 #include "GUIConstants.h"
+#include "Shortcuts.h"
 
 namespace Listener {
+  // Listeners are members of the widgets that use them: they are added to
+  // MainWindow while they're needed and deleted from it after, nothing is
+  // allocated when the pointer enters or leaves a widget
   class Abstract {
    public:
     virtual ~Abstract() = default;
     virtual void ProcessSystemEvent(const SystemEvent& event) = 0;
+    // added to MainWindow for at least one event type
+    bool IsListening() const {
+      return listened_types_count_ != 0;
+    }
+
+   private:
+    friend Widget::MainWindow;
+    uint listened_types_count_ = 0;
+    // MainWindow's dispatch that has already called the listener
+    uint dispatch_stamp_ = 0;
   };
 
   class Drag : public Abstract {
@@ -32,13 +46,12 @@ namespace Listener {
   class BasicButtonClick : public Abstract {
    public:
     BasicButtonClick() = delete;
-    BasicButtonClick(Functor::Abstract* action_func, Widget::BasicButton* button);
+    BasicButtonClick(Widget::BasicButton* button);
     ~BasicButtonClick() override = default;
 
     void ProcessSystemEvent(const SystemEvent& event) override;
 
    private:
-    Functor::Abstract* action_func_;
     Widget::BasicButton* button_;
   };
 
@@ -68,6 +81,15 @@ namespace Listener {
 }
 
 namespace Widget {
+  // Edges of the parent a widget keeps its distance to when the parent is
+  // resized. A widget anchored to opposite edges stretches with it.
+  enum Anchor {
+    kAnchorLeft   = 1,
+    kAnchorTop    = 2,
+    kAnchorRight  = 4,
+    kAnchorBottom = 8
+  };
+
   class Abstract {
    public:
     Abstract() = delete;
@@ -78,20 +100,50 @@ namespace Widget {
     Rectangle GetPosition();
     void SetPosition(const Rectangle& pos);
     void SetDrawFunc(DrawFunctor::Abstract* draw_func);
+    void SetParent(Widget::Abstract* parent);
+    // Must be called whenever the widget starts to look differently,
+    // drops render caches of the widget and of all its ancestors
+    void Invalidate();
     virtual Point2D<int> Move(const Point2D<int>& shift,
                               const Rectangle& bounds);
 
     virtual void Resize(const Point2D<int>& corner_shift,
                         int width_shift, int height_shift,
                         const Rectangle& bounds);
+    // kAnchorLeft | kAnchorTop by default, such widgets stay as they are
+    void SetAnchors(uint anchors);
+    // Keeps the corner, children of containers follow their anchors
+    void SetSize(uint width, uint height);
+    // Called by the parent after its size changed by the shifts. Only
+    // widgets anchored to the right or bottom edge change, so the rest of
+    // the tree isn't even visited.
+    void OnParentResized(int width_shift, int height_shift);
 
     virtual bool IsMouseCoordinatesInBound(const Point2D<uint>& mouse_coordinates);
     virtual void Draw();
     virtual void ProcessSystemEvent(const SystemEvent& event) = 0;
+    // Windows taking the keyboard focus when clicked, see MainWindow
+    virtual bool IsKeyboardFocusable() const {
+      return false;
+    }
+    // Key events while the widget has the keyboard focus. Returns false if
+    // the key is passed on to the global shortcuts.
+    virtual bool ProcessKey(const SystemEvent& event) {
+      return false;
+    }
 
    protected:
     Rectangle position_;
     DrawFunctor::Abstract* draw_func_;
+    Widget::Abstract* parent_;
+    uint anchors_;
+
+    virtual void DropRenderCache() {}
+    // Must be called whenever position_ is changed, parents keep copies
+    // of the bounds of their children
+    void OnPositionChanged();
+    virtual void OnChildMoved() {}
+    virtual void OnResized(int width_shift, int height_shift) {}
   };
 
   class Icon : public Abstract {
@@ -114,18 +166,44 @@ namespace Widget {
 
     void DeleteChildren();
     void DrawChildren();
-    std::list<Widget::Abstract*>& GetChildren();
+    const std::vector<Widget::Abstract*>& GetChildren();
+    // the widget becomes the topmost child
     void AddChild(Widget::Abstract* widget);
+    // Takes the widget out without deleting it. Returns false if it isn't
+    // a child.
+    bool RemoveChild(Widget::Abstract* widget);
     void PushMouseUpToChildInFocus(const SystemEvent& event);
     void PushMouseMotionToChildInFocus(const SystemEvent& event);
     void PushMouseDownToChildInFocusAndTopHim(const SystemEvent& event);
 
+    // Opt-in retained mode: the container renders itself with its
+    // subtree into an offscreen texture and then only copies it to the
+    // screen until something inside is invalidated
+    void EnableRenderCache(Render* render);
+
     void Draw() override;
     Point2D<int> Move(const Point2D<int>& shift,
                       const Rectangle& bounds) override;
 
    protected:
-    std::list<Widget::Abstract*> children_;
+    // the topmost child first
+    std::vector<Widget::Abstract*> children_;
+    // bounds of children_ in the same order: hit-tests scan this array and
+    // touch only the widget they find
+    std::vector<Rectangle> children_bounds_;
+    bool are_bounds_valid_;
+    Render* cache_render_;
+    Texture* cache_;
+    bool is_cache_valid_;
+
+    void DropRenderCache() override;
+    void OnChildMoved() override;
+    void OnResized(int width_shift, int height_shift) override;
+    virtual void OnChildRemoved(Widget::Abstract* child) {}
+    // the topmost child under coordinate, nullptr if there is none
+    Widget::Abstract* FindChildAt(const Point2D<uint>& coordinate);
+    // the child goes to the front, the others keep their order
+    void RaiseChild(Widget::Abstract* child);
   };
 
   class MainWindow : public AbstractContainer {
@@ -138,13 +216,28 @@ namespace Widget {
 
     void AddListener(SystemEvent::Type event_type, Listener::Abstract* listener);
     void DeleteListener(SystemEvent::Type event_type, Listener::Abstract* listener);
+    // deletes it for every event type it listens to, e.g. before it's destroyed
+    void DeleteListener(Listener::Abstract* listener);
     void ProcessSystemEvent(const SystemEvent& event) override;
+    // Keys go to the focused child first, then to the global shortcuts.
+    // The focus moves to focusable children when they are clicked, and to
+    // the topmost focusable one when the focused child is removed.
+    void SetKeyboardFocus(Widget::Abstract* child);
+    bool ProcessKey(const SystemEvent& event) override;
+    // shortcuts working whatever has the focus
+    ShortcutTable& GetShortcuts();
 
    private:
-    std::unordered_map<SystemEvent::Type, std::unordered_set<Listener::Abstract*> > listener_table_;
-    std::unordered_set<Listener::Abstract*> processed_listeners_;
+    // listeners added for each event type, in the order they were added.
+    // The vectors keep their capacity, so adding a listener doesn't
+    // allocate once the app is warmed up.
+    std::vector<Listener::Abstract*> listener_table_[SystemEvent::kUndefined];
+    uint dispatch_stamp_;
+    Widget::Abstract* keyboard_focus_;
+    ShortcutTable shortcuts_;
+
+    void OnChildRemoved(Widget::Abstract* child) override;
 
-    bool IsListenerProcessed(Listener::Abstract* listener);
     void SendEventToListeners(const SystemEvent& event);
   };
 
@@ -176,7 +269,7 @@ namespace Widget {
    protected:
     Widget::MainWindow* main_window_;
     Functor::MoveWidget* move_func_;
-    Listener::Drag* drag_listener_;
+    Listener::Drag drag_listener_;
   };
 
   struct ButtonDrawFunctors {
@@ -205,8 +298,8 @@ namespace Widget {
     Widget::MainWindow* main_window_;
     Functor::Abstract* action_func_;
     ButtonDrawFunctors draw_funcs_;
-    Listener::BasicButtonClick* click_listener_;
-    Listener::BasicButtonHover* hover_listener_;
+    Listener::BasicButtonClick click_listener_;
+    Listener::BasicButtonHover hover_listener_;
 
     void StartListeningMouseUp();
     void StartListeningMouseMotion();
@@ -232,7 +325,7 @@ namespace Widget {
     Widget::MainWindow* main_window_;
     Functor::Abstract* action_func_;
     ButtonDrawFunctors draw_funcs_;
-    Listener::ButtonOnPress* hover_listener_;
+    Listener::ButtonOnPress hover_listener_;
     bool is_in_click_state_;
 
     void StartListeningMouseMotion();
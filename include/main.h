@@ -124,6 +124,11 @@ struct Rectangle {
   uint height;
 };
 
+inline bool IsIntersecting(const Rectangle& lhs, const Rectangle& rhs) {
+  return lhs.corner.x < rhs.corner.x + (int)rhs.width && rhs.corner.x < lhs.corner.x + (int)lhs.width &&
+         lhs.corner.y < rhs.corner.y + (int)rhs.height && rhs.corner.y < lhs.corner.y + (int)lhs.height;
+}
+
 template <typename T>
 Point2D<T> operator+(const Point2D<T>& lhs,
 	                   const Point2D<T>& rhs) {
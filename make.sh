@@ -1,3 +1,4 @@
 #/bin/bash
 
-make -B --jobs
+# ./make.sh [CONFIG=debug|release|profile] [MARCH=...]
+make -B --jobs "$@"
@@ -24,22 +24,31 @@ namespace DrawFunctor {
 	  }
 	}
 
- 	void TilingTexture::Action(const Rectangle& place_to_draw) {
-	  Rectangle place = place_to_draw;
-	  ChangePlaceToDrawIfNeeded(&place, offset_);
-
+	// covers place with copies of texture not scaled, cutting the last ones
+	static void AppendTiles(std::vector<TexturedQuad>* quads, const Texture* texture,
+		                      const Rectangle& place) {
 		Point2D<int> max_c = Point2D<int>{place.corner.x + (int)place.width, place.corner.y + (int)place.height};
 		Point2D<int> cur_c = place.corner;
-		uint width = texture_->GetWidth();
-		uint height = texture_->GetHeight();
+		uint width = texture->GetWidth();
+		uint height = texture->GetHeight();
 		for (; cur_c.y < max_c.y; cur_c.y += height) {
 			for (cur_c.x = place.corner.x; cur_c.x < max_c.x; cur_c.x += width) {
-				Rectangle dst = {cur_c, Min((uint)(max_c.x - cur_c.x), width), Min((uint)(max_c.y - cur_c.y), height)};
-				texture_->DrawWithNoScale(&dst);
+				uint tile_width = Min((uint)(max_c.x - cur_c.x), width);
+				uint tile_height = Min((uint)(max_c.y - cur_c.y), height);
+				quads->push_back({texture, {{0, 0}, tile_width, tile_height}, {cur_c, tile_width, tile_height}});
 			}
 		}
 	}
 
+ 	void TilingTexture::Action(const Rectangle& place_to_draw) {
+	  Rectangle place = place_to_draw;
+	  ChangePlaceToDrawIfNeeded(&place, offset_);
+
+	  quads_.clear();
+	  AppendTiles(&quads_, texture_, place);
+	  Texture::DrawQuads(quads_);
+	}
+
 	ScalableTexture::ScalableTexture(Texture* texture,
 		                               const Point2D<uint>& offset)
 	: texture_(texture), offset_(offset) {}
@@ -50,6 +59,74 @@ namespace DrawFunctor {
  		texture_->Draw(nullptr, &place);
  	}
 
+	NineSliceTexture::NineSliceTexture(Texture* frame,
+		                                 Texture* center,
+		                                 uint border_width,
+		                                 CenterMode center_mode)
+	: frame_(frame), center_(center), border_width_(border_width),
+	  center_mode_(center_mode), frame_slices_(), are_slices_computed_(false) {}
+
+	// columns (or rows) of a nine-slice grid: border, middle, border
+	static void SplitInThree(int start, uint length, uint border, int* starts, uint* lengths) {
+		assert(length >= 2 * border);
+		starts[0] = start;
+		starts[1] = start + (int)border;
+		starts[2] = start + (int)(length - border);
+		lengths[0] = border;
+		lengths[1] = length - 2 * border;
+		lengths[2] = border;
+	}
+
+	void NineSliceTexture::ComputeFrameSlices() {
+		int xs[3] = {};
+		int ys[3] = {};
+		uint widths[3] = {};
+		uint heights[3] = {};
+		SplitInThree(0, frame_->GetWidth(), border_width_, xs, widths);
+		SplitInThree(0, frame_->GetHeight(), border_width_, ys, heights);
+
+		size_t slice = 0;
+		for (size_t row = 0; row < 3; ++row) {
+			for (size_t column = 0; column < 3; ++column) {
+				if (row != 1 || column != 1) {
+					frame_slices_[slice++] = {{xs[column], ys[row]}, widths[column], heights[row]};
+				}
+			}
+		}
+		are_slices_computed_ = true;
+	}
+
+ 	void NineSliceTexture::Action(const Rectangle& place_to_draw) {
+ 		if (!are_slices_computed_) {
+ 			ComputeFrameSlices();
+ 		}
+
+		int xs[3] = {};
+		int ys[3] = {};
+		uint widths[3] = {};
+		uint heights[3] = {};
+		SplitInThree(place_to_draw.corner.x, place_to_draw.width, border_width_, xs, widths);
+		SplitInThree(place_to_draw.corner.y, place_to_draw.height, border_width_, ys, heights);
+
+		quads_.clear();
+		size_t slice = 0;
+		for (size_t row = 0; row < 3; ++row) {
+			for (size_t column = 0; column < 3; ++column) {
+				if (row != 1 || column != 1) {
+					quads_.push_back({frame_, frame_slices_[slice++], {{xs[column], ys[row]}, widths[column], heights[row]}});
+				}
+			}
+		}
+
+		Rectangle center = {{xs[1], ys[1]}, widths[1], heights[1]};
+		if (center_mode_ == kScalable) {
+			quads_.push_back({center_, {{0, 0}, center_->GetWidth(), center_->GetHeight()}, center});
+		} else {
+			AppendTiles(&quads_, center_, center);
+		}
+		Texture::DrawQuads(quads_);
+ 	}
+
 	TextTexture::TextTexture(Texture* text,
 		                       const Point2D<uint>& offset)
 	: text_(text), offset_(offset) {}
@@ -82,7 +159,8 @@ namespace Functor {
  	MoveWidget::MoveWidget(Widget::Abstract* widget_to_move,
 	                       const Rectangle& widget_bounds)
  	: widget_to_move_(widget_to_move),
- 	  widget_bounds_(widget_bounds) {}
+ 	  widget_bounds_(widget_bounds),
+ 	  shift_{0, 0} {}
 
 	void MoveWidget::SetWidgetToMove(Widget::Abstract* widget_to_move) {
 		widget_to_move_ = widget_to_move;
@@ -90,10 +168,11 @@ namespace Functor {
 
  	void MoveWidget::Action() {
  		widget_to_move_->Move(shift_, widget_bounds_);
+ 		shift_ = Point2D<int>{0, 0};
  	}
 
- 	void MoveWidget::SetShift(const Point2D<int>& shift) {
- 	 shift_ = shift;
+ 	void MoveWidget::AddShift(const Point2D<int>& shift) {
+ 	 shift_ += shift;
  	}
 
  	void CloseWidget::SetWidgetToClose(Widget::Abstract* widget_to_close) {
@@ -111,18 +190,10 @@ namespace Functor {
 
   void CloseWidget::Action() {
     $;
-  	std::list<Widget::Abstract*>& children = window_parent_->GetChildren();
-  	auto child = children.begin();
-  	for (; child != children.end(); ++child) {
-  		if (*child == widget_to_close_) {
-  			break;
-  		}
-  	}
-  	if (child == children.end()) {
+  	if (!window_parent_->RemoveChild(widget_to_close_)) {
   		printf("Warning: Close was called but didn't close anything\n");
   		return;
   	}
-  	children.erase(child);
   	delete widget_to_close_;
     $$;
   }
@@ -171,18 +242,10 @@ namespace Functor {
 
   void DropdownListClose::Action() {
     list_->is_visible_ = false;
-    std::list<Widget::Abstract*>& children = list_->window_parent_->GetChildren();
-    auto it = children.begin();
-    for (; it != children.end(); ++it) {
-      if (*it == list_) {
-        break;
-      }
-    }
-    if (it == children.end()) {
+    if (!list_->window_parent_->RemoveChild(list_)) {
       printf("Warning: DropdownList::Hide was called but worked inproperly\n");
       return;
     }
-    children.erase(it);
     list_->button_toggler_->StopTheClick();
   }
 
@@ -10,16 +10,23 @@
 #include "../include/DropdownList.h"
 #include "../include/Plugin.h"
 #include "../include/Canvas.h"
+#include "../include/TextureCache.h"
+#include "../include/Atlas.h"
+#include "../include/PngExport.h"
+#include "../include/Autosave.h"
 
 // Declaring textures and draw functors
-#define DEFINE_SKIN(Scalability, Name, file_name)         \
+#define DEFINE_SKIN(Scalability, Name, file_name, Loading) \
   Texture* kTexture##Name;                                \
   DrawFunctor::Scalability##Texture* kFuncDraw##Name;     \
-  DrawFunctor::MultipleFunctors* kFuncDraw##Name##Framed; \
-  DrawFunctor::Scalability##Texture* kFuncDraw##Name##Auxiliary;
+  DrawFunctor::NineSliceTexture* kFuncDraw##Name##Framed;
   #include "../include/DEFINE_SKIN.h"
 #undef DEFINE_SKIN
 
+// longest wait for events when nothing happens, plugin reloading and
+// autosave are checked at least this often
+const uint kIdleWaitMs = 100;
+
 class MainBar : public Widget::Container {
  public:
   MainBar() = delete;
@@ -53,7 +60,11 @@ class MainBar : public Widget::Container {
                                  {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
     func_->SetDropdownList(dropdown_list_);
     AddChild(some_button);
+    main_window->GetShortcuts().Bind(SDL_SCANCODE_N, KeyboardKeyClickInfo::kCtrl, func_open_canvas_);
 
+    EnableRenderCache(render);
+    // spans the whole window whatever its size
+    SetAnchors(Widget::kAnchorLeft | Widget::kAnchorTop | Widget::kAnchorRight);
     main_window->AddChild(this);
   }
 
@@ -67,15 +78,31 @@ class MainBar : public Widget::Container {
 Plugin::API* kApi;
 MainBar* kMainBar;
 
-void RunApp(GLWindow* gl_window, Render* render) {
+void RunApp(GLWindow* gl_window, Render* render,
+            const std::vector<std::string>& file_paths) {
+  // the thread that creates the queue is the one that pops from it
+  FunctorQueue& queue = FunctorQueue::GetInstance();
+  // starts opening plugins in the background
+  Tool::Manager::GetInstance();
+
+  // Packing skins into atlases. Skins needed for the first frame are
+  // packed right away, the others are decoded in the background and
+  // packed on first use
+  Atlas* kAtlasEager = new Atlas(render);
+  Atlas* kAtlasLazy = new Atlas(render);
+  #define DEFINE_SKIN(Scalability, Name, file_name, Loading) \
+    kAtlas##Loading->Add(file_name)
+    #include "../include/DEFINE_SKIN.h"
+  #undef DEFINE_SKIN
+  kAtlasEager->Pack();
+
   // Initializing textures and draw functors
-  Texture* kTextureFrame = new Texture("tex_black.png", render);
-  DrawFunctor::Abstract* kFuncDrawFrame = new DrawFunctor::ScalableTexture(kTextureFrame);
-  #define DEFINE_SKIN(Scalability, Name, file_name)  \
-    kTexture##Name = new Texture(file_name, render); \
+  Texture* kTextureFrame = kAtlasEager->GetTexture("tex_black.png");
+  #define DEFINE_SKIN(Scalability, Name, file_name, Loading) \
+    kTexture##Name = kAtlas##Loading->GetTexture(file_name); \
     kFuncDraw##Name = new DrawFunctor::Scalability##Texture(kTexture##Name); \
-    kFuncDraw##Name##Auxiliary = new DrawFunctor::Scalability##Texture(kTexture##Name, {kStandardFrameWidth, kStandardFrameWidth}); \
-    kFuncDraw##Name##Framed = new DrawFunctor::MultipleFunctors({kFuncDrawFrame, kFuncDraw##Name##Auxiliary})
+    kFuncDraw##Name##Framed = new DrawFunctor::NineSliceTexture(kTextureFrame, kTexture##Name, kStandardFrameWidth, \
+                                                                DrawFunctor::NineSliceTexture::k##Scalability)
     #include "../include/DEFINE_SKIN.h"
   #undef DEFINE_SKIN
 
@@ -87,6 +114,15 @@ void RunApp(GLWindow* gl_window, Render* render) {
   auto main_window = new Widget::MainWindow({{0, 0}, gl_window_width, gl_window_height}, {}, kFuncDrawTexMainLight);
   kApi = new Plugin::API(main_window, render);
   kMainBar = new MainBar(main_window, render, gl_window_width);
+  // canvases of a run that crashed or was closed unsaved are opened too
+  std::vector<std::string> opened_paths = file_paths;
+  for (auto& path : Autosaver::RecoverSnapshots()) {
+    opened_paths.push_back(path);
+  }
+  for (size_t i = 0; i < opened_paths.size(); ++i) {
+    int ofs = 30 * (int)i;
+    new UserWidget::PaintWindow({{350 + ofs, 150 + ofs}, 1200, 700}, main_window, render, opened_paths[i].c_str());
+  }
   // auto canvas = new UserWidget::PaintWindow({{100, 100}, 1000, 700}, main_window, render);
   // auto hole_window = new UserWidget::HoleWindow({{-500, kStandardTitlebarHeight}, 510, 700}, main_window, render);
 
@@ -102,17 +138,27 @@ void RunApp(GLWindow* gl_window, Render* render) {
   // tex.SaveToPNG("tex_black");
 
 
-  SystemEvent event = {};
+  EventPump& event_pump = EventPump::GetInstance();
+  event_pump.Start();
   bool is_running = true;
   while (is_running) {
     uint time1 = SDL_GetTicks();
 
+    render->BeginFrame();
     render->SetBackgroundColor(kBlack);
     main_window->Draw();
+    render->EndFrame();
+    // presenting may wait for vsync, input that came while drawing is
+    // timestamped before that
+    event_pump.PumpInput();
     gl_window->RenderPresent(render);
 
-    event.type = SystemEvent::kUndefined;
-    while (IsSomeEventInQueue(&event)) {
+    // the whole batch is collected and filtered before dispatching
+    size_t events_count = event_pump.Collect();
+    const SystemEvent* events = event_pump.GetEvents();
+    bool is_idle = events_count == 0;
+    for (size_t i = 0; i < events_count; ++i) {
+      const SystemEvent& event = events[i];
       switch (event.type) {
         case SystemEvent::kUndefined: {
           assert("BUG");
@@ -131,11 +177,19 @@ void RunApp(GLWindow* gl_window, Render* render) {
       }
     }
 
-    FunctorQueue& queue = FunctorQueue::GetInstance();
-
-    while (!queue.IsEmpty()) {
-      Functor::Abstract* func = queue.Pop();
+    for (Functor::Abstract* func = queue.Pop(); func != nullptr; func = queue.Pop()) {
       func->Action();
+      // filters may take long
+      event_pump.PumpInput();
+      is_idle = false;
+    }
+    Autosaver::GetInstance().Tick(SDL_GetTicks());
+    // no tool or filter is running between frames
+    Tool::Manager::GetInstance()->ReloadChangedPlugins();
+    // Nothing changed, so the next frame would be the same. Background
+    // jobs wake the loop when they push their results.
+    if (is_idle) {
+      queue.WaitIdle(kIdleWaitMs);
     }
     // SDL_Delay(200);
 
@@ -147,14 +201,16 @@ void RunApp(GLWindow* gl_window, Render* render) {
   delete Tool::Manager::GetInstance();
   // deleting textures and draw functors
   delete kTextureFrame;
-  delete kFuncDrawFrame;
-  #define DEFINE_SKIN(Scalability, Name, file_name) \
+  #define DEFINE_SKIN(Scalability, Name, file_name, Loading) \
     delete kTexture##Name;                          \
     delete kFuncDraw##Name;                         \
-    delete kFuncDraw##Name##Auxiliary;              \
     delete kFuncDraw##Name##Framed;
     #include "../include/DEFINE_SKIN.h"
   #undef DEFINE_SKIN
+  delete kAtlasEager;
+  delete kAtlasLazy;
+  TextureCache::GetInstance().PrintStats();
+  FunctorQueue::GetInstance().PrintStats();
 }
 
 // 0x6080001ddea0
\ No newline at end of file
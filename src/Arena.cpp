@@ -0,0 +1,64 @@
+#include <cstdint>
+#include <cstdlib>
+#include "../include/Arena.h"
+
+// blocks start right after their header, aligned for any object
+static const size_t kBlockHeaderSize =
+  (sizeof(void*) + sizeof(size_t) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) * alignof(std::max_align_t);
+
+Arena::Arena(size_t block_size)
+: block_size_(block_size), blocks_(nullptr), cur_(nullptr), end_(nullptr),
+  destructors_(nullptr), objects_count_(0) {}
+
+Arena::~Arena() {
+  Clear();
+  free(blocks_);
+}
+
+void Arena::AddBlock(size_t min_size) {
+  size_t size = Max(block_size_, min_size);
+  Block* block = static_cast<Block*>(malloc(kBlockHeaderSize + size));
+  assert(block != nullptr);
+  *block = {blocks_, size};
+  blocks_ = block;
+  cur_ = reinterpret_cast<char*>(block) + kBlockHeaderSize;
+  end_ = cur_ + size;
+}
+
+void* Arena::Allocate(size_t size, size_t alignment) {
+  assert(alignment <= alignof(std::max_align_t));
+  uintptr_t cur = reinterpret_cast<uintptr_t>(cur_);
+  size_t padding = (alignment - cur % alignment) % alignment;
+  if (blocks_ == nullptr || padding + size > (size_t)(end_ - cur_)) {
+    AddBlock(size);
+    padding = 0;
+  }
+  void* memory = cur_ + padding;
+  cur_ += padding + size;
+  return memory;
+}
+
+void Arena::Clear() {
+  for (Destructor* destructor = destructors_; destructor != nullptr;) {
+    // the record lives in the arena too, read it before anything is freed
+    Destructor* next = destructor->next;
+    destructor->destroy(destructor->object);
+    destructor = next;
+  }
+  destructors_ = nullptr;
+  objects_count_ = 0;
+  if (blocks_ == nullptr) {
+    return;
+  }
+  while (blocks_->next != nullptr) {
+    Block* next = blocks_->next;
+    free(blocks_);
+    blocks_ = next;
+  }
+  cur_ = reinterpret_cast<char*>(blocks_) + kBlockHeaderSize;
+  end_ = cur_ + blocks_->size;
+}
+
+size_t Arena::GetObjectsCount() const {
+  return objects_count_;
+}
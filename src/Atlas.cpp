@@ -0,0 +1,220 @@
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <unistd.h>
+#include "../include/Atlas.h"
+#include "../include/Render.h"
+#include "../include/Texture.h"
+#include "../include/GUIConstants.h"
+#include "../include/ThreadPool.h"
+
+const uint kMaxAtlasPageSize = 4096;
+// every image is surrounded by a copy of its border pixels, so that
+// scaled (linearly filtered) drawing doesn't bleed neighbours in
+const int kAtlasPadding = 1;
+
+static void BlitPart(SDL_Surface* src, SDL_Rect src_rect,
+                     SDL_Surface* dst, SDL_Rect dst_rect) {
+  SDL_BlitSurface(src, &src_rect, dst, &dst_rect);
+}
+
+static void BlitExtruded(SDL_Surface* src, SDL_Surface* dst, int x, int y) {
+  const int w = src->w;
+  const int h = src->h;
+  BlitPart(src, {0, 0, w, h}, dst, {x, y, w, h});
+
+  BlitPart(src, {0, 0, w, 1},         dst, {x, y - 1, w, 1});
+  BlitPart(src, {0, h - 1, w, 1},     dst, {x, y + h, w, 1});
+  BlitPart(src, {0, 0, 1, h},         dst, {x - 1, y, 1, h});
+  BlitPart(src, {w - 1, 0, 1, h},     dst, {x + w, y, 1, h});
+
+  BlitPart(src, {0, 0, 1, 1},         dst, {x - 1, y - 1, 1, 1});
+  BlitPart(src, {w - 1, 0, 1, 1},     dst, {x + w, y - 1, 1, 1});
+  BlitPart(src, {0, h - 1, 1, 1},     dst, {x - 1, y + h, 1, 1});
+  BlitPart(src, {w - 1, h - 1, 1, 1}, dst, {x + w, y + h, 1, 1});
+}
+
+Atlas::Atlas(Render* render)
+: render_(render), is_packed_(false) {}
+
+Atlas::~Atlas() {
+  for (auto& image : images_) {
+    if (image.decoding.valid()) {
+      image.surface = image.decoding.get();
+    }
+    if (image.surface != nullptr) {
+      SDL_FreeSurface(image.surface);
+    }
+  }
+  for (auto page : pages_) {
+    SDL_DestroyTexture(page);
+  }
+}
+
+void Atlas::Add(const char* image_name) {
+  assert(!is_packed_ && "Atlas is already packed");
+  for (auto& image : images_) {
+    if (image.name == image_name) {
+      return;
+    }
+  }
+
+  std::string image_path = std::string(kSkinsDirName) + "/" + image_name;
+  if (access(image_path.c_str(), F_OK) != 0) {
+    printf("ERROR: can't find file %s\nAborted\n", image_path.c_str());
+    exit(255);
+  }
+
+  Image image = {image_name, {}, nullptr, 0, {}};
+  image.decoding = ThreadPool::GetInstance().Submit([image_path]() {
+    SDL_Surface* surface = IMG_Load(image_path.c_str());
+    if (surface != nullptr) {
+      SDL_SetSurfaceBlendMode(surface, SDL_BLENDMODE_NONE);
+    }
+    return surface;
+  });
+  images_.push_back(std::move(image));
+}
+
+uint Atlas::GetMaxPageSize() const {
+  SDL_RendererInfo info = {};
+  SDL_GetRendererInfo(render_->GetRender(), &info);
+  uint max_size = kMaxAtlasPageSize;
+  // 0 means the renderer has no limit
+  if (info.max_texture_width > 0) {
+    max_size = Min(max_size, (uint)info.max_texture_width);
+  }
+  if (info.max_texture_height > 0) {
+    max_size = Min(max_size, (uint)info.max_texture_height);
+  }
+  return max_size;
+}
+
+// Shelf packing: images sorted by height are put left to right in rows,
+// a new row is started when the current one is full and a new page when
+// there's no room for another row
+void Atlas::PlaceImages(std::vector<Point2D<uint>>* pages_sizes) {
+  const uint max_size = GetMaxPageSize();
+  const uint padding = 2 * kAtlasPadding;
+
+  std::vector<Image*> order;
+  for (auto& image : images_) {
+    order.push_back(&image);
+  }
+  std::stable_sort(order.begin(), order.end(), [](const Image* lhs, const Image* rhs) {
+    return lhs->region.height > rhs->region.height;
+  });
+
+  bool is_page_open = false;
+  size_t page = 0;
+  uint cur_x = 0;
+  uint cur_y = 0;
+  uint shelf_height = 0;
+
+  for (auto image : order) {
+    const uint w = image->region.width + padding;
+    const uint h = image->region.height + padding;
+
+    if (w > max_size || h > max_size) {
+      // too big to share a page with anything else
+      image->page = pages_sizes->size();
+      image->region.corner = Point2D<int>{kAtlasPadding, kAtlasPadding};
+      pages_sizes->push_back({w, h});
+      is_page_open = false;
+      continue;
+    }
+
+    if (is_page_open && cur_x + w > max_size) {
+      cur_x = 0;
+      cur_y += shelf_height;
+      shelf_height = 0;
+    }
+    if (!is_page_open || cur_y + h > max_size) {
+      page = pages_sizes->size();
+      pages_sizes->push_back({0, 0});
+      is_page_open = true;
+      cur_x = 0;
+      cur_y = 0;
+      shelf_height = 0;
+    }
+
+    image->page = page;
+    image->region.corner = Point2D<int>{(int)cur_x + kAtlasPadding, (int)cur_y + kAtlasPadding};
+    cur_x += w;
+    shelf_height = Max(shelf_height, h);
+
+    Point2D<uint>& page_size = (*pages_sizes)[page];
+    page_size.x = Max(page_size.x, cur_x);
+    page_size.y = Max(page_size.y, cur_y + shelf_height);
+  }
+}
+
+void Atlas::UploadPages(const std::vector<Point2D<uint>>& pages_sizes) {
+  for (size_t page = 0; page < pages_sizes.size(); ++page) {
+    SDL_Surface* page_surface =
+    SDL_CreateRGBSurfaceWithFormat(0, pages_sizes[page].x, pages_sizes[page].y,
+                                   32, SDL_PIXELFORMAT_RGBA8888);
+    assert(page_surface != nullptr);
+
+    for (auto& image : images_) {
+      if (image.page == page) {
+        BlitExtruded(image.surface, page_surface,
+                     image.region.corner.x, image.region.corner.y);
+      }
+    }
+
+    SDL_Texture* texture = render_->CreateTextureFromSurface(page_surface);
+    assert(texture != nullptr);
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    SDL_FreeSurface(page_surface);
+    pages_.push_back(texture);
+  }
+}
+
+void Atlas::Pack() {
+  assert(!is_packed_ && "Atlas is already packed");
+  for (auto& image : images_) {
+    image.surface = image.decoding.get();
+    if (image.surface == nullptr) {
+      printf("ERROR: can't decode %s: %s\nAborted\n", image.name.c_str(), SDL_GetError());
+      exit(255);
+    }
+    image.region = {{0, 0}, (uint)image.surface->w, (uint)image.surface->h};
+  }
+
+  std::vector<Point2D<uint>> pages_sizes;
+  PlaceImages(&pages_sizes);
+  UploadPages(pages_sizes);
+
+  for (auto& image : images_) {
+    SDL_FreeSurface(image.surface);
+    image.surface = nullptr;
+  }
+  is_packed_ = true;
+}
+
+Texture* Atlas::GetTexture(const char* image_name) {
+  for (size_t i = 0; i < images_.size(); ++i) {
+    if (images_[i].name == image_name) {
+      if (!is_packed_) {
+        return new Texture(this, i, render_);
+      }
+      return new Texture(pages_[images_[i].page], images_[i].region, render_);
+    }
+  }
+  printf("ERROR: %s wasn't added to atlas\n", image_name);
+  assert(0);
+  return nullptr;
+}
+
+SDL_Texture* Atlas::GetImagePage(size_t image_index, Rectangle* region) {
+  assert(image_index < images_.size());
+  if (!is_packed_) {
+    Pack();
+  }
+  *region = images_[image_index].region;
+  return pages_[images_[image_index].page];
+}
+
+size_t Atlas::GetPagesCount() const {
+  return pages_.size();
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "../include/Autosave.h"
+#include "../include/Canvas.h"
+#include "../include/GUIConstants.h"
+#include "../include/ThreadPool.h"
+#include "../include/FunctorQueue.h"
+
+// a crash loses at most this much work
+const uint kAutosavePeriodMs = 30000;
+
+class FinishWrittenSnapshots : public Functor::Abstract {
+ public:
+  void Action() override {
+    Autosaver::GetInstance().FinishWritten();
+  }
+};
+
+static FinishWrittenSnapshots kFinishWrittenSnapshots;
+
+static bool CopyFile(const std::string& source_path, const std::string& path) {
+  int source_fd = open(source_path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (source_fd < 0) {
+    return false;
+  }
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    close(source_fd);
+    return false;
+  }
+  // the kernel copies without passing the data through user space
+  ssize_t copied = 0;
+  do {
+    copied = copy_file_range(source_fd, nullptr, fd, nullptr, 1 << 30, 0);
+  } while (copied > 0);
+  close(source_fd);
+  return close(fd) == 0 && copied == 0;
+}
+
+std::vector<std::string> Autosaver::RecoverSnapshots() {
+  std::vector<std::string> recovered;
+  DIR* dir = opendir(kAutosaveDirName);
+  if (dir == nullptr) {
+    return recovered;
+  }
+  for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+    int pid = 0;
+    uint number = 0;
+    char extension[16] = {};
+    if (sscanf(entry->d_name, "canvas_%d_%u%15s", &pid, &number, extension) != 3 ||
+        strcmp(extension, Document::kExtension) != 0) {
+      continue;
+    }
+    // another copy of the app is still writing it
+    if (pid == getpid() || kill(pid, 0) == 0 || errno != ESRCH) {
+      continue;
+    }
+    if (mkdir(kDocumentsDirName, 0755) != 0 && errno != EEXIST) {
+      printf("Warning: can't create %s\n", kDocumentsDirName);
+      break;
+    }
+    std::string snapshot_path = std::string(kAutosaveDirName) + "/" + entry->d_name;
+    std::string path = std::string(kDocumentsDirName) + "/recovered_" +
+                       std::to_string(pid) + "_" + std::to_string(number) + Document::kExtension;
+    if (rename(snapshot_path.c_str(), path.c_str()) != 0) {
+      printf("Warning: can't move %s to %s\n", snapshot_path.c_str(), path.c_str());
+      continue;
+    }
+    printf("Recovered %s\n", path.c_str());
+    recovered.push_back(path);
+  }
+  closedir(dir);
+  return recovered;
+}
+
+Autosaver::Autosaver()
+: snapshots_count_(0), last_tick_ms_(0) {
+  // the pool must outlive the autosaver, whose destructor waits for jobs
+  ThreadPool::GetInstance();
+}
+
+Autosaver::~Autosaver() {
+  for (auto entry : entries_) {
+    if (entry->job.valid()) {
+      entry->job.wait();
+    }
+    delete entry->snapshot;
+    delete entry;
+  }
+}
+
+void Autosaver::Add(Widget::Canvas* canvas) {
+  // a dead copy of the app with the same pid could have left its snapshots,
+  // Document::Create doesn't overwrite them
+  std::string path;
+  do {
+    path = std::string(kAutosaveDirName) + "/canvas_" + std::to_string(getpid()) +
+           "_" + std::to_string(snapshots_count_++) + Document::kExtension;
+  } while (access(path.c_str(), F_OK) == 0);
+  entries_.push_back(new Entry{canvas, path, "", 0, 0, nullptr, false, 0, {}, {}, false});
+}
+
+void Autosaver::Remove(Widget::Canvas* canvas) {
+  auto it = entries_.begin();
+  while (it != entries_.end() && (*it)->canvas != canvas) {
+    ++it;
+  }
+  assert(it != entries_.end());
+  Entry* entry = *it;
+  entries_.erase(it);
+
+  if (entry->job.valid()) {
+    FinishSnapshot(entry);
+  }
+  if (canvas->HasUnsavedChanges()) {
+    // the snapshot is the only copy of the work now, it's recovered on the
+    // next launch
+    if (!entry->is_failed &&
+        canvas->GetPaintingArea()->GetChangesCount() != entry->changes_count) {
+      StartSnapshot(entry);
+      if (entry->job.valid()) {
+        FinishSnapshot(entry);
+      }
+    }
+  } else if (entry->width != 0) {
+    unlink(entry->path.c_str());
+  }
+  delete entry->snapshot;
+  delete entry;
+}
+
+void Autosaver::FinishWritten() {
+  for (auto entry : entries_) {
+    if (entry->job.valid() && entry->is_written) {
+      FinishSnapshot(entry);
+    }
+  }
+}
+
+void Autosaver::Tick(uint now_ms) {
+  if (now_ms - last_tick_ms_ < kAutosavePeriodMs) {
+    return;
+  }
+  last_tick_ms_ = now_ms;
+  for (auto entry : entries_) {
+    if (!entry->job.valid() && !entry->is_failed &&
+        entry->canvas->GetPaintingArea()->GetChangesCount() != entry->changes_count) {
+      StartSnapshot(entry);
+    }
+  }
+}
+
+void Autosaver::StartSnapshot(Entry* entry) {
+  assert(!entry->job.valid());
+  Plugin::Texture* texture = entry->canvas->GetPaintingArea();
+  if (entry->width == 0) {
+    if (mkdir(kAutosaveDirName, 0755) != 0 && errno != EEXIST) {
+      printf("Warning: can't create %s, canvases aren't autosaved\n", kAutosaveDirName);
+      entry->is_failed = true;
+      return;
+    }
+    // tiles outside of the document aren't kept by saving either
+    const Document* document = entry->canvas->GetDocument();
+    if (document != nullptr) {
+      entry->source_path = document->GetPath();
+      entry->width = document->GetWidth();
+      entry->height = document->GetHeight();
+    } else {
+      entry->width = texture->GetWidth();
+      entry->height = texture->GetHeight();
+    }
+  }
+
+  // tiles of the texture and of the snapshot share the grid, only the
+  // number of them in a row may differ
+  uint tiles_count_x = (texture->GetWidth() + Document::kTileSize - 1) / Document::kTileSize;
+  uint snapshot_tiles_count_x = (entry->width + Document::kTileSize - 1) / Document::kTileSize;
+  for (uint index : texture->TakeChangedTiles()) {
+    uint x = index % tiles_count_x * Document::kTileSize;
+    uint y = index / tiles_count_x * Document::kTileSize;
+    if (x >= entry->width || y >= entry->height) {
+      continue;
+    }
+    Rectangle tile_rect = {{(int)x, (int)y}, Min(Document::kTileSize, entry->width - x),
+                           Min(Document::kTileSize, entry->height - y)};
+    uint snapshot_index = y / Document::kTileSize * snapshot_tiles_count_x + x / Document::kTileSize;
+    entry->tiles.push_back({snapshot_index, std::vector<uint>((size_t)tile_rect.width * tile_rect.height)});
+    texture->ReadPixels(entry->tiles.back().pixels.data(), tile_rect);
+  }
+  entry->changes_count = texture->GetChangesCount();
+
+  entry->is_written = false;
+  entry->job = ThreadPool::GetInstance().Submit([entry]() {
+    bool is_ok = WriteSnapshot(entry);
+    entry->is_written = true;
+    FunctorQueue::GetInstance().Push(&kFinishWrittenSnapshots);
+    return is_ok;
+  });
+}
+
+bool Autosaver::WriteSnapshot(Entry* entry) {
+  if (entry->snapshot == nullptr) {
+    if (!entry->source_path.empty()) {
+      if (CopyFile(entry->source_path, entry->path)) {
+        entry->snapshot = Document::Open(entry->path);
+      }
+    } else {
+      entry->snapshot = Document::Create(entry->path, entry->width, entry->height);
+    }
+    if (entry->snapshot == nullptr) {
+      return false;
+    }
+  }
+  // already on the pool, compressing on it again could wait for itself
+  return entry->snapshot->Save(entry->tiles, false);
+}
+
+void Autosaver::FinishSnapshot(Entry* entry) {
+  if (!entry->job.get()) {
+    // changes taken by this snapshot are missing from the file now
+    printf("Warning: can't write %s, the canvas isn't autosaved anymore\n", entry->path.c_str());
+    entry->is_failed = true;
+  }
+  entry->tiles.clear();
+}
@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <errno.h>
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include "../include/main.h"
+#include "../include/Batch.h"
+#include "../include/Render.h"
+#include "../include/Plugin.h"
+#include "../include/HeadlessWidgets.h"
+#include "../include/ThreadPool.h"
+#include "../include/Tools.h"
+
+namespace Batch {
+  struct Options {
+    std::vector<std::string> filters;
+    std::vector<std::string> images;
+    std::string output_dir;
+    size_t threads_count = 0;
+  };
+
+  class Api : public Plugin::IAPI {
+   public:
+    explicit Api(Render* render) : t_factory_(render) {}
+    Plugin::IWidgetFactory* GetWidgetFactory() override {return &w_factory_;}
+    Plugin::ITextureFactory* GetTextureFactory() override {return &t_factory_;}
+
+   private:
+    Headless::WidgetFactory w_factory_;
+    Plugin::TextureFactory t_factory_;
+  };
+
+  // Everything a thread needs to apply filters: SDL renderers can't be
+  // shared between threads and plugins keep textures of the API's render
+  class Worker {
+   public:
+    Worker() = delete;
+    Worker(const std::vector<Tool::Manager::PluginLib>& libs);
+    ~Worker();
+
+    // nullptr if no plugin has a filter with this name
+    Plugin::IFilter* FindFilter(const std::string& name) const;
+    // whether the plugin having the filter exports IsCreateThreadSafe
+    bool IsThreadSafe(const std::string& name) const;
+    bool Process(const std::string& image_path,
+                 const std::vector<Plugin::IFilter*>& chain,
+                 const std::string& output_dir);
+
+   private:
+    struct Instance {
+      Plugin::IPlugin* plugin;
+      Plugin::DestroyFunction destroy;
+      bool is_create_thread_safe;
+    };
+
+    const Instance* FindInstance(const std::string& name) const;
+
+    // the software render draws to it, but everything is drawn to textures
+    SDL_Surface* surface_;
+    Render* render_;
+    Api* api_;
+    std::vector<Instance> plugins_;
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+  };
+
+  Worker::Worker(const std::vector<Tool::Manager::PluginLib>& libs) {
+    surface_ = SDL_CreateRGBSurfaceWithFormat(0, 1, 1, 32, SDL_PIXELFORMAT_RGBA8888);
+    assert(surface_ != nullptr);
+    render_ = new Render(surface_);
+    api_ = new Api(render_);
+    for (auto& lib : libs) {
+      Plugin::IPlugin* plugin = lib.create(api_);
+      assert(plugin != nullptr);
+      plugins_.push_back({plugin, lib.destroy, lib.is_create_thread_safe});
+    }
+  }
+
+  Worker::~Worker() {
+    for (auto& instance : plugins_) {
+      instance.destroy(instance.plugin);
+    }
+    delete api_;
+    delete render_;
+    SDL_FreeSurface(surface_);
+  }
+
+  const Worker::Instance* Worker::FindInstance(const std::string& name) const {
+    for (auto& instance : plugins_) {
+      Plugin::Filters filters = instance.plugin->GetFilters();
+      for (uint i = 0; i < filters.count; ++i) {
+        if (name == filters.filters[i]->GetName()) {
+          return &instance;
+        }
+      }
+    }
+    return nullptr;
+  }
+
+  Plugin::IFilter* Worker::FindFilter(const std::string& name) const {
+    const Instance* instance = FindInstance(name);
+    if (instance == nullptr) {
+      return nullptr;
+    }
+    Plugin::Filters filters = instance->plugin->GetFilters();
+    for (uint i = 0; i < filters.count; ++i) {
+      if (name == filters.filters[i]->GetName()) {
+        return filters.filters[i];
+      }
+    }
+    return nullptr;
+  }
+
+  bool Worker::IsThreadSafe(const std::string& name) const {
+    const Instance* instance = FindInstance(name);
+    return instance != nullptr && instance->is_create_thread_safe;
+  }
+
+  // "dir/photo.jpg" -> "photo"
+  static std::string GetStem(const std::string& path) {
+    size_t begin = path.find_last_of('/');
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    size_t end = path.find_last_of('.');
+    if (end == std::string::npos || end < begin) {
+      end = path.size();
+    }
+    return path.substr(begin, end - begin);
+  }
+
+  bool Worker::Process(const std::string& image_path,
+                       const std::vector<Plugin::IFilter*>& chain,
+                       const std::string& output_dir) {
+    SDL_Surface* image = IMG_Load(image_path.c_str());
+    if (image == nullptr) {
+      printf("Warning: can't load %s: %s\n", image_path.c_str(), IMG_GetError());
+      return false;
+    }
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA8888, 0);
+    SDL_FreeSurface(image);
+    if (converted == nullptr) {
+      printf("Warning: can't convert %s: %s\n", image_path.c_str(), SDL_GetError());
+      return false;
+    }
+
+    uint width = (uint)converted->w;
+    uint height = (uint)converted->h;
+    std::vector<Plugin::Color> pixels((size_t)width * height);
+    for (uint y = 0; y < height; ++y) {
+      memcpy(pixels.data() + y * width, (char*)converted->pixels + y * converted->pitch,
+             width * sizeof(Plugin::Color));
+    }
+    SDL_FreeSurface(converted);
+
+    Plugin::Texture canvas(width, height, render_, ::Color{});
+    canvas.WritePixels(pixels.data());
+    for (auto filter : chain) {
+      filter->Apply(&canvas);
+    }
+    return canvas.SaveToPNG((output_dir + "/" + GetStem(image_path)).c_str());
+  }
+
+  static void PrintUsage() {
+    printf("Usage: ./out %s -f <filter> [-f <filter>]... -o <dir> [-j <threads>] <image>...\n",
+           kFlag);
+  }
+
+  static bool ParseOptions(int argc, char** argv, Options* options) {
+    for (int i = 0; i < argc; ++i) {
+      std::string arg = argv[i];
+      bool has_value = i + 1 < argc;
+      if (arg == "-f" && has_value) {
+        options->filters.push_back(argv[++i]);
+      } else if (arg == "-o" && has_value) {
+        options->output_dir = argv[++i];
+      } else if (arg == "-j" && has_value) {
+        options->threads_count = (size_t)atoi(argv[++i]);
+      } else if (arg[0] == '-') {
+        return false;
+      } else {
+        options->images.push_back(arg);
+      }
+    }
+    return !options->filters.empty() && !options->output_dir.empty() &&
+           !options->images.empty();
+  }
+
+  int Run(int argc, char** argv) {
+    Options options;
+    if (!ParseOptions(argc, argv, &options)) {
+      PrintUsage();
+      return 1;
+    }
+    if (mkdir(options.output_dir.c_str(), 0755) != 0 && errno != EEXIST) {
+      printf("ERROR: can't create %s\n", options.output_dir.c_str());
+      return 1;
+    }
+    IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
+
+    std::vector<Tool::Manager::PluginLib> libs;
+    for (auto& path : Tool::Manager::FindPlugins()) {
+      Tool::Manager::PluginLib lib = Tool::Manager::OpenPlugin(path);
+      if (lib.handle != nullptr) {
+        libs.push_back(lib);
+      }
+    }
+
+    int exit_code = 0;
+    bool is_thread_safe = true;
+    {
+      // every worker looks the filters up by itself, this one only checks
+      // the names before any work is started
+      Worker checker(libs);
+      for (auto& name : options.filters) {
+        if (checker.FindFilter(name) == nullptr) {
+          printf("ERROR: no plugin has filter \"%s\"\n", name.c_str());
+          exit_code = 1;
+        } else if (!checker.IsThreadSafe(name)) {
+          is_thread_safe = false;
+        }
+      }
+    }
+
+    // Plugins not exporting IsCreateThreadSafe may keep their instance in
+    // a global, so only one instance of them can exist at a time. Workers
+    // instantiate only the thread-safe ones, unless the filters need others
+    std::vector<Tool::Manager::PluginLib> worker_libs;
+    for (auto& lib : libs) {
+      if (!is_thread_safe || lib.is_create_thread_safe) {
+        worker_libs.push_back(lib);
+      }
+    }
+
+    if (exit_code == 0) {
+      size_t threads_count = options.threads_count;
+      if (threads_count == 0) {
+        threads_count = Max(1u, std::thread::hardware_concurrency());
+      }
+      threads_count = Min(threads_count, options.images.size());
+      if (!is_thread_safe && threads_count > 1) {
+        printf("Warning: some filters aren't thread-safe, using one thread\n");
+        threads_count = 1;
+      }
+
+      std::atomic<size_t> next_image(0);
+      std::atomic<size_t> failed_count(0);
+      {
+        ThreadPool pool(threads_count);
+        std::vector<std::future<void>> workers;
+        for (size_t i = 0; i < threads_count; ++i) {
+          workers.push_back(pool.Submit([&]() {
+            Worker worker(worker_libs);
+            std::vector<Plugin::IFilter*> chain;
+            for (auto& name : options.filters) {
+              chain.push_back(worker.FindFilter(name));
+            }
+            for (size_t image = next_image++; image < options.images.size(); image = next_image++) {
+              if (!worker.Process(options.images[image], chain, options.output_dir)) {
+                ++failed_count;
+              }
+            }
+          }));
+        }
+        for (auto& worker : workers) {
+          worker.get();
+        }
+      }
+
+      printf("Processed %lu images, %lu failed\n",
+             options.images.size(), failed_count.load());
+      exit_code = failed_count == 0 ? 0 : 1;
+    }
+
+    for (auto& lib : libs) {
+      dlclose(lib.handle);
+    }
+    IMG_Quit();
+    return exit_code;
+  }
+}
@@ -1,11 +1,28 @@
 #include <iostream>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <SDL2/SDL.h>
 #include "../include/Canvas.h"
+#include "../include/Render.h"
+#include "../include/Document.h"
+#include "../include/Autosave.h"
 #include "../include/Skins.h"
 #include "../include/GUIConstants.h"
 #include "../include/ScrollBar.h"
 #include "../include/DropdownList.h"
 
+const uint kDefaultAreaWidth = 3000;
+const uint kDefaultAreaHeight = 2000;
 const uint kPaletteWidth = 200 - kStandardResizeOfs;
+const uint kPaletteButtonWidth = kStandardButtonWidth + 10;
+const uint kPaletteButtonsInRow = (kPaletteWidth - 2 * 15) / kPaletteButtonWidth;
+const uint kPaletteOfs = (kPaletteWidth - kPaletteButtonsInRow * kPaletteButtonWidth) / 2;
+// tools are picked with 1-9 and filters applied with F1-F12, in the
+// order of the lists
+const uint kToolShortcutsCount = 9;
+const uint kFilterShortcutsCount = 12;
 
 class MainBar : public Widget::Container {
  public:
@@ -48,16 +65,18 @@ namespace Listener {
     return Point2D<int>(mouse_coordinates) - canvas_->GetPosition().corner + Point2D<int>(canvas_->GetViewPos());
   }
 
-  Canvas::Canvas(Widget::Canvas* canvas,
-                 Plugin::Texture* painting_area,
-                 Point2D<uint> mouse_coord)
+  Canvas::Canvas(Widget::Canvas* canvas)
   : canvas_(canvas),
-    painting_area_(painting_area),
+    painting_area_(nullptr),
     manager_(Tool::Manager::GetInstance()),
-    is_in_action_(true),
-    prev_coord_(mouse_coord)
-  {
-    manager_->ActionBegin(painting_area_, CalculateRelativeCoordinate(mouse_coord));
+    is_in_action_(false),
+    prev_coord_(0, 0) {}
+
+  void Canvas::Begin(Point2D<uint> mouse_coord, uint64_t time_us) {
+    painting_area_ = canvas_->GetPaintingArea();
+    is_in_action_ = true;
+    prev_coord_ = mouse_coord;
+    manager_->ActionBegin(painting_area_, CalculateRelativeCoordinate(mouse_coord), time_us);
   }
 
   void Canvas::ProcessSystemEvent(const SystemEvent& event) {
@@ -79,11 +98,12 @@ namespace Listener {
         }
 
         if (!is_in_action_) {
-          manager_->ActionBegin(painting_area_, CalculateRelativeCoordinate(new_mp));
+          manager_->ActionBegin(painting_area_, CalculateRelativeCoordinate(new_mp), event.time_us);
           is_in_action_ = true;
         }
 
-        manager_->Action(painting_area_, CalculateRelativeCoordinate(prev_coord_), Point2D<int>(new_mp) - Point2D<int>(prev_coord_));
+        manager_->Action(painting_area_, CalculateRelativeCoordinate(prev_coord_), Point2D<int>(new_mp) - Point2D<int>(prev_coord_),
+                         event.time_us);
         prev_coord_ = new_mp;
         break;
       }
@@ -94,51 +114,187 @@ namespace Listener {
 }
 
 namespace Widget {
+  static bool HasExtension(const char* path, const char* extension) {
+    size_t path_len = strlen(path);
+    size_t extension_len = strlen(extension);
+    return path_len >= extension_len && strcmp(path + path_len - extension_len, extension) == 0;
+  }
+
   Canvas::Canvas(const Rectangle& position,
                  Widget::MainWindow* main_window,
-                 Render* render)
+                 Render* render,
+                 const char* file_path)
   : Abstract(position, nullptr),
     main_window_(main_window),
-    area_width_(3000),
-    area_height_(2000),
-    painting_area_(new Plugin::Texture(area_width_, area_height_, render, {0, 0, 0, 0})),
-    painting_listener_(nullptr),
-    view_pos_(0, 0) {}
+    area_width_(kDefaultAreaWidth),
+    area_height_(kDefaultAreaHeight),
+    painting_area_(nullptr),
+    painting_listener_(this),
+    view_pos_(0, 0),
+    import_(nullptr),
+    document_(nullptr),
+    saved_changes_(0)
+  {
+    uint file_width = 0;
+    uint file_height = 0;
+    bool is_file_ok = false;
+    if (file_path != nullptr && HasExtension(file_path, Document::kExtension)) {
+      document_ = Document::Open(file_path);
+      is_file_ok = document_ != nullptr;
+      if (is_file_ok) {
+        file_width = document_->GetWidth();
+        file_height = document_->GetHeight();
+      } else {
+        printf("Warning: can't open document %s, opening an empty canvas\n", file_path);
+      }
+    } else if (file_path != nullptr) {
+      is_file_ok = ImageImport::ReadSize(file_path, &file_width, &file_height);
+      if (!is_file_ok) {
+        printf("Warning: %s isn't a PNG image, opening an empty canvas\n", file_path);
+      }
+    }
+
+    SDL_RendererInfo info = {};
+    SDL_GetRendererInfo(render->GetRender(), &info);
+    if (is_file_ok && info.max_texture_width != 0 &&
+        (file_width > (uint)info.max_texture_width || file_height > (uint)info.max_texture_height)) {
+      printf("Warning: %s is %ux%u, textures can't be bigger than %dx%d\n", file_path,
+             file_width, file_height, info.max_texture_width, info.max_texture_height);
+      is_file_ok = false;
+      delete document_;
+      document_ = nullptr;
+    }
+    if (is_file_ok) {
+      // the view never shows more than the canvas, scrolling relies on it
+      area_width_ = Max(file_width, position.width);
+      area_height_ = Max(file_height, position.height);
+    }
+
+    painting_area_ = new Plugin::Texture(area_width_, area_height_, render, {0, 0, 0, 0});
+    painting_area_->TrackChangedTiles(Document::kTileSize);
+    if (document_ != nullptr) {
+      loaded_tiles_.assign(document_->GetTilesCount(), false);
+    } else if (is_file_ok) {
+      import_ = new ImageImport(file_path, painting_area_);
+    }
+    Autosaver::GetInstance().Add(this);
+  }
+
+  void Canvas::LoadTiles(const Rectangle& region) {
+    if (document_ == nullptr) {
+      return;
+    }
+    std::vector<uint> pixels(Document::kTileSize * Document::kTileSize);
+    for (uint i = 0; i < loaded_tiles_.size(); ++i) {
+      if (loaded_tiles_[i]) {
+        continue;
+      }
+      Rectangle tile_rect = document_->GetTileRect(i);
+      if (!IsIntersecting(tile_rect, region)) {
+        continue;
+      }
+      if (!document_->ReadTile(i, pixels.data())) {
+        printf("Warning: tile %u of %s is damaged\n", i, document_->GetPath().c_str());
+      } else {
+        painting_area_->WritePixels(pixels.data(), tile_rect);
+      }
+      loaded_tiles_[i] = true;
+    }
+  }
+
+  void Canvas::LoadAllTiles() {
+    LoadTiles({{0, 0}, area_width_, area_height_});
+  }
+
+  bool Canvas::SaveDocument(const std::string& path) {
+    if (document_ == nullptr) {
+      document_ = Document::Create(path, area_width_, area_height_);
+      if (document_ == nullptr) {
+        return false;
+      }
+      // everything is on the texture, nothing in the file yet
+      loaded_tiles_.assign(document_->GetTilesCount(), true);
+    }
+    // Only tiles changed since the last save are appended, a new document
+    // starts transparent like the texture. Tiles of the texture and of the
+    // document share the grid, only the number of them in a row may differ
+    uint tiles_count_x = (area_width_ + Document::kTileSize - 1) / Document::kTileSize;
+    std::vector<Document::Tile> tiles;
+    for (uint index : painting_area_->GetUnsavedTiles()) {
+      uint x = index % tiles_count_x * Document::kTileSize;
+      uint y = index / tiles_count_x * Document::kTileSize;
+      if (x >= document_->GetWidth() || y >= document_->GetHeight()) {
+        continue;
+      }
+      uint document_index = y / Document::kTileSize * document_->GetTilesCountX() +
+                            x / Document::kTileSize;
+      // the file has the only copy of tiles that were never loaded
+      if (!loaded_tiles_[document_index]) {
+        continue;
+      }
+      Rectangle tile_rect = document_->GetTileRect(document_index);
+      tiles.push_back({document_index, std::vector<uint>((size_t)tile_rect.width * tile_rect.height)});
+      painting_area_->ReadPixels(tiles.back().pixels.data(), tile_rect);
+    }
+    if (!document_->Save(tiles)) {
+      return false;
+    }
+    painting_area_->MarkTilesSaved();
+    saved_changes_ = painting_area_->GetChangesCount();
+    return true;
+  }
+
+  const Document* Canvas::GetDocument() const {
+    return document_;
+  }
+
+  bool Canvas::HasUnsavedChanges() const {
+    return painting_area_->GetChangesCount() != saved_changes_;
+  }
 
   Canvas::~Canvas() {
     $;
-    if (painting_listener_ != nullptr) {
+    if (painting_listener_.IsListening()) {
       FinishPainting();
     }
+    Autosaver::GetInstance().Remove(this);
+    delete import_;
+    delete document_;
     delete painting_area_;
     $$;
   }
 
-  void Canvas::StartPainting(Point2D<uint> mouse_coordinate) {
+  void Canvas::StartPainting(Point2D<uint> mouse_coordinate, uint64_t time_us) {
     assert((int)mouse_coordinate.x >= position_.corner.x);
     assert((int)mouse_coordinate.y >= position_.corner.y);
-    painting_listener_ = new Listener::Canvas(this, painting_area_, mouse_coordinate);
-    main_window_->AddListener(SystemEvent::kMouseMotion, painting_listener_);
-    main_window_->AddListener(SystemEvent::kMouseButtonUp, painting_listener_);
+    painting_listener_.Begin(mouse_coordinate, time_us);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &painting_listener_);
+    main_window_->AddListener(SystemEvent::kMouseButtonUp, &painting_listener_);
   }
 
   void Canvas::FinishPainting() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, painting_listener_);
-    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, painting_listener_);
-    delete painting_listener_;
-    painting_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &painting_listener_);
+    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, &painting_listener_);
   }
 
   void Canvas::ProcessSystemEvent(const SystemEvent& event) {
     switch (event.type) {
       case SystemEvent::kMouseButtonDown: {
-        StartPainting(event.info.mouse_click.coordinate);
+        StartPainting(event.info.mouse_click.coordinate, event.time_us);
         break;
       }
     }
   }
 
   void Canvas::Draw() {
+    if (import_ != nullptr) {
+      import_->UploadDecoded();
+      if (import_->IsFinished()) {
+        delete import_;
+        import_ = nullptr;
+      }
+    }
+    LoadTiles({Point2D<int>(view_pos_), position_.width, position_.height});
     kTextureTexWhite->DrawWithNoScale(&position_);
     painting_area_->Draw(position_, Point2D<int>(view_pos_));
   }
@@ -185,11 +341,26 @@ namespace Functor {
   }
 
   ApplyFilter::ApplyFilter(Plugin::IFilter* filter,
-                           Plugin::ITexture* canvas)
+                           Widget::Canvas* canvas)
   : filter_(filter), canvas_(canvas) {}
 
   void ApplyFilter::Action() {
-    filter_->Apply(canvas_);
+    canvas_->LoadAllTiles();
+    filter_->Apply(canvas_->GetPaintingArea());
+  }
+
+  ExportCanvas::ExportCanvas(UserWidget::PaintWindow* paint_window)
+  : paint_window_(paint_window) {}
+
+  void ExportCanvas::Action() {
+    paint_window_->ExportCanvas();
+  }
+
+  SaveCanvas::SaveCanvas(UserWidget::PaintWindow* paint_window)
+  : paint_window_(paint_window) {}
+
+  void SaveCanvas::Action() {
+    paint_window_->SaveCanvas();
   }
 }
 
@@ -201,20 +372,17 @@ namespace UserWidget {
     unsigned char green = rand() % 256;
     unsigned char blue = rand() % 256;
     Color color = {red, green, blue};
-    auto func_pick_color = new Functor::PickColor(color);
+    auto func_pick_color = arena_.New<Functor::PickColor>(color);
     char buf[100] = {};
     sprintf(buf, "Color %u %u %u", red, green, blue);
     list->AddButton({func_pick_color, buf});
 
-    auto texture_color = new Texture(button_width, button_width, render, color);
-    textures_to_free_.push_back(texture_color);
+    auto texture_color = arena_.New<Texture>(button_width, button_width, render, color);
     assert(button_width > 10);
-    auto func_draw_color = new DrawFunctor::ScalableTexture(texture_color, {5, 5});
-    auto func_draw_color_hover = new DrawFunctor::MultipleFunctors({kFuncDrawTexMainLightExtra, func_draw_color});
-    draw_funcs_to_free_.push_back(func_draw_color);
-    draw_funcs_to_free_.push_back(func_draw_color_hover);
+    auto func_draw_color = arena_.New<DrawFunctor::ScalableTexture>(texture_color, Point2D<uint>{5, 5});
+    auto func_draw_color_hover = arena_.New<DrawFunctor::MultipleFunctors>(
+      std::initializer_list<DrawFunctor::Abstract*>{kFuncDrawTexMainLightExtra, func_draw_color});
 
-    pick_color_funcs_to_free_.push_back(func_pick_color);
     return new Widget::BasicButton({coord, button_width, button_width},
                                    main_window, func_pick_color, {func_draw_color, func_draw_color_hover});
   }
@@ -223,105 +391,218 @@ namespace UserWidget {
                                                          const Point2D<int>& coord, Widget::MainWindow* main_window) {
     static char buf[100] = {};
     sprintf(buf, "tools/%s", tool->GetIconFileName());
-    auto texture = new Texture(buf, render);
-    auto func_draw_texture = new DrawFunctor::ScalableTexture(texture, {5, 5});
-
-    auto func_draw_highlight0 = new DrawFunctor::PaletteButtonHighlight(button_width - 2, {1, 1}, render, {50, 50, 50});
-    auto func_draw_highlight1 = new DrawFunctor::PaletteButtonHighlight(button_width - 2, {1, 1}, render, {30, 30, 30});
-    auto func_draw_highlight_frame = new DrawFunctor::PaletteButtonHighlight(button_width, {0, 0}, render, kBlack);
-    auto func_draw_hover = new DrawFunctor::MultipleFunctors({func_draw_highlight_frame, func_draw_highlight0, func_draw_texture});
-    auto func_draw_click = new DrawFunctor::MultipleFunctors({func_draw_highlight_frame, func_draw_highlight1, func_draw_texture});
-
-    auto func_set_tool = new Functor::SetTool(this, tool, main_window, nullptr);
+    auto texture = tools_arena_.New<Texture>(buf, render);
+    auto func_draw_texture = tools_arena_.New<DrawFunctor::ScalableTexture>(texture, Point2D<uint>{5, 5});
+
+    auto func_draw_highlight0 = tools_arena_.New<DrawFunctor::PaletteButtonHighlight>(
+      button_width - 2, Point2D<uint>{1, 1}, render, Color{50, 50, 50});
+    auto func_draw_highlight1 = tools_arena_.New<DrawFunctor::PaletteButtonHighlight>(
+      button_width - 2, Point2D<uint>{1, 1}, render, Color{30, 30, 30});
+    auto func_draw_highlight_frame = tools_arena_.New<DrawFunctor::PaletteButtonHighlight>(
+      button_width, Point2D<uint>{0, 0}, render, kBlack);
+    auto func_draw_hover = tools_arena_.New<DrawFunctor::MultipleFunctors>(
+      std::initializer_list<DrawFunctor::Abstract*>{func_draw_highlight_frame, func_draw_highlight0, func_draw_texture});
+    auto func_draw_click = tools_arena_.New<DrawFunctor::MultipleFunctors>(
+      std::initializer_list<DrawFunctor::Abstract*>{func_draw_highlight_frame, func_draw_highlight1, func_draw_texture});
+
+    auto func_set_tool = tools_arena_.New<Functor::SetTool>(this, tool, main_window, nullptr);
     auto pick_tool_button = new Widget::BasicButton({{coord.x, coord.y}, button_width, button_width},
                                                     main_window, func_set_tool, {func_draw_texture, func_draw_hover, func_draw_click});
     func_set_tool->SetToolButton(pick_tool_button);
 
-    textures_to_free_.push_back(texture);
-    draw_funcs_to_free_.push_back(func_draw_texture);
-    draw_funcs_to_free_.push_back(func_draw_highlight0);
-    draw_funcs_to_free_.push_back(func_draw_highlight1);
-    draw_funcs_to_free_.push_back(func_draw_highlight_frame);
-    draw_funcs_to_free_.push_back(func_draw_hover);
-    draw_funcs_to_free_.push_back(func_draw_click);
-    set_tool_funcs_to_free_.push_back(func_set_tool);
-
     return pick_tool_button;
   }
 
   void PaintWindow::CreatePalette(Widget::Container* palette, Render* render,
                                   const Point2D<int>& coord, Widget::MainWindow* main_window) {
-    const uint button_width = kStandardButtonWidth + 10;
-    const uint ofs = 15;
-    const uint buttons_in_row = (kPaletteWidth - 2 * ofs) / button_width;
-    const uint actual_ofs = (kPaletteWidth - buttons_in_row * button_width) / 2;
-    int x = coord.x + actual_ofs;
-    int cur_y = coord.y + actual_ofs;
-
-    ::Tool::Manager* manager = ::Tool::Manager::GetInstance();
-    std::list<Plugin::ITool*>& tools = manager->GetToolsList();
+    palette_ = palette;
+    palette_corner_ = coord + Point2D<int>{(int)kPaletteOfs, (int)kPaletteOfs};
 
-    auto func = new Functor::DropdownListPopUp(nullptr);
-    auto some_button =
+    auto func = arena_.New<Functor::DropdownListPopUp>(nullptr);
+    tools_button_ =
     new UserWidget::ButtonOnPressWithText({41, 0}, main_window, func, {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra},
                                           render, kWhite}, "Tools");
-    auto tools_list =
-    new UserWidget::DropdownList(main_window, main_window,
-                                 some_button, 200, kStandardTitlebarHeight, {},
-                                 {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
-    func->SetDropdownList(tools_list);
-    kMainBar->AddChild(some_button);
-    int _width = some_button->GetPosition().width;
+    tools_list_ =
+    arena_.New<UserWidget::DropdownList>(main_window, main_window,
+                                         tools_button_, 200, kStandardTitlebarHeight, std::initializer_list<UserWidget::DropdownList::ButtonInfo>{},
+                                         UserWidget::ButtonDrawInfo{{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
+    func->SetDropdownList(tools_list_);
+    kMainBar->AddChild(tools_button_);
+    int _width = tools_button_->GetPosition().width;
 
 
 
-    auto func0 = new Functor::DropdownListPopUp(nullptr);
-    auto button_colors =
+    auto func0 = arena_.New<Functor::DropdownListPopUp>(nullptr);
+    colors_button_ =
     new UserWidget::ButtonOnPressWithText({41 + _width, 0}, main_window, func0, {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra},
                                           render, kWhite}, "Colors");
-    auto colors_list =
-    new UserWidget::DropdownList(main_window, main_window,
-                                 button_colors, 200, kStandardTitlebarHeight, {},
-                                 {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
-    func0->SetDropdownList(colors_list);
-    kMainBar->AddChild(button_colors);
+    colors_list_ =
+    arena_.New<UserWidget::DropdownList>(main_window, main_window,
+                                         colors_button_, 200, kStandardTitlebarHeight, std::initializer_list<UserWidget::DropdownList::ButtonInfo>{},
+                                         UserWidget::ButtonDrawInfo{{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
+    func0->SetDropdownList(colors_list_);
+    kMainBar->AddChild(colors_button_);
+
+    // colors go right after the rows of tools, they are moved down by
+    // CreateToolsAndFilters
+    for (uint i = 0; i < 20; ++i) {
+      Point2D<int> button_coord = palette_corner_ + Point2D<int>{(int)(kPaletteButtonWidth * (i % kPaletteButtonsInRow)),
+                                                                 (int)(kPaletteButtonWidth * (i / kPaletteButtonsInRow))};
+      auto button = CreateColorButton(render, kPaletteButtonWidth, button_coord, main_window, colors_list_);
+      color_buttons_.push_back(button);
+      palette->AddChild(button);
+    }
+  }
+
+  void PaintWindow::CreateToolsAndFilters() {
+    ::Tool::Manager* manager = ::Tool::Manager::GetInstance();
+    std::list<Plugin::ITool*>& tools = manager->GetToolsList();
 
     uint i = 0;
     for (auto tool : tools) {
-      tools_list->AddButton({new Functor::SetTool(this, tool, main_window, nullptr), tool->GetName()});
-      pref_panels_[tool] = tool->GetPreferencesPanel();
-      int temp_x = x + button_width * (i % buttons_in_row);
-      palette->AddChild(CreatePickToolButton(tool, render, button_width,
-                                             Point2D<int>{temp_x, cur_y}, main_window));
-      if (i % buttons_in_row == buttons_in_row - 1) {
-        cur_y += button_width;
+      auto func_set_tool = tools_arena_.New<Functor::SetTool>(this, tool, main_window_, nullptr);
+      tools_list_->AddButton({func_set_tool, tool->GetName()});
+      if (i < kToolShortcutsCount) {
+        shortcuts_.Bind(SDL_SCANCODE_1 + i, 0, func_set_tool);
       }
+      pref_panels_[tool] = tool->GetPreferencesPanel();
+      Point2D<int> button_coord = palette_corner_ + Point2D<int>{(int)(kPaletteButtonWidth * (i % kPaletteButtonsInRow)),
+                                                                 (int)(kPaletteButtonWidth * (i / kPaletteButtonsInRow))};
+      auto button = CreatePickToolButton(tool, render_, kPaletteButtonWidth, button_coord, main_window_);
+      tool_buttons_.push_back(button);
+      palette_->AddChild(button);
       ++i;
     }
 
-    for (uint i = 0; i < 20; ++i) {
-      palette->AddChild(CreateColorButton(render, button_width, {x + (int)(button_width * (i % buttons_in_row)), cur_y}, main_window, colors_list));
-      if (i % buttons_in_row == buttons_in_row - 1) {
-        cur_y += button_width;
+    uint rows_count = (i + kPaletteButtonsInRow - 1) / kPaletteButtonsInRow;
+    if (rows_count != tools_rows_count_) {
+      Point2D<int> shift = {0, ((int)rows_count - (int)tools_rows_count_) * (int)kPaletteButtonWidth};
+      for (auto button : color_buttons_) {
+        button->Move(shift, kStandardMoveBounds);
       }
+      tools_rows_count_ = rows_count;
+    }
+
+    uint filter_index = 0;
+    for (auto filter : manager->GetFiltersList()) {
+      auto func_apply_filter = tools_arena_.New<Functor::ApplyFilter>(filter, canvas_);
+      filters_list_->AddButton({func_apply_filter, filter->GetName()});
+      if (filter_index < kFilterShortcutsCount) {
+        shortcuts_.Bind(SDL_SCANCODE_F1 + filter_index, 0, func_apply_filter);
+      }
+      ++filter_index;
     }
   }
 
-  void PaintWindow::TogglePrefPanel(Plugin::ITool* tool) {
-    bool was_deleted = false;
-    if (cur_pref_panel_ != nullptr) {
-      for (auto it = children_.begin(); it != children_.end(); ++it) {
-        if (*it == cur_pref_panel_) {
-          children_.erase(it);
-          was_deleted = true;
-          break;
+  void PaintWindow::DeleteToolsAndFilters() {
+    HidePrefPanel();
+    pref_panels_.clear();
+    tools_list_->Clear();
+    filters_list_->Clear();
+    // their functors are freed with the arena
+    for (uint i = 0; i < kToolShortcutsCount; ++i) {
+      shortcuts_.Unbind(SDL_SCANCODE_1 + i, 0);
+    }
+    for (uint i = 0; i < kFilterShortcutsCount; ++i) {
+      shortcuts_.Unbind(SDL_SCANCODE_F1 + i, 0);
+    }
+
+    for (auto button : tool_buttons_) {
+      palette_->RemoveChild(button);
+      delete button;
+    }
+    tool_buttons_.clear();
+    tools_arena_.Clear();
+  }
+
+  void PaintWindow::OnPluginsUnloading() {
+    DeleteToolsAndFilters();
+  }
+
+  void PaintWindow::OnPluginsLoaded() {
+    CreateToolsAndFilters();
+  }
+
+  // <dir>/canvas_<date>_<time>[_<n>]<extension> of no existing file. Names
+  // have one-second resolution, canvases saved in the same second get numbers.
+  // With do_reserve the file is created empty, for files written later on
+  // the ThreadPool; "" if it can't be created
+  static std::string MakeFilePath(const char* dir_name, const char* extension,
+                                  bool do_reserve = false) {
+    char stem[100] = {};
+    time_t now = time(nullptr);
+    strftime(stem, sizeof(stem), "canvas_%Y%m%d_%H%M%S", localtime(&now));
+    for (uint number = 0; ; ++number) {
+      std::string path = std::string(dir_name) + "/" + stem +
+                         (number == 0 ? "" : "_" + std::to_string(number)) + extension;
+      if (!do_reserve) {
+        if (access(path.c_str(), F_OK) != 0) {
+          return path;
         }
+        continue;
+      }
+      int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+      if (fd >= 0) {
+        close(fd);
+        return path;
       }
+      if (errno != EEXIST) {
+        return "";
+      }
+    }
+  }
+
+  void PaintWindow::ExportCanvas() {
+    if (is_exporting_) {
+      return;
+    }
+    if (mkdir(kExportsDirName, 0755) != 0 && errno != EEXIST) {
+      printf("Warning: can't create %s\n", kExportsDirName);
+      return;
     }
+    // exports of other canvases may still be writing files of this second
+    std::string path = MakeFilePath(kExportsDirName, ".png", true);
+    if (path.empty()) {
+      printf("Warning: can't create a file in %s\n", kExportsDirName);
+      return;
+    }
+    is_exporting_ = true;
+    canvas_->LoadAllTiles();
+    Png::Exporter::GetInstance().Export(canvas_->GetPaintingArea(), path, this);
+  }
+
+  void PaintWindow::SaveCanvas() {
+    std::string path;
+    if (canvas_->GetDocument() != nullptr) {
+      path = canvas_->GetDocument()->GetPath();
+    } else {
+      if (mkdir(kDocumentsDirName, 0755) != 0 && errno != EEXIST) {
+        printf("Warning: can't create %s\n", kDocumentsDirName);
+        return;
+      }
+      path = MakeFilePath(kDocumentsDirName, Document::kExtension);
+    }
+    if (canvas_->SaveDocument(path)) {
+      printf("Saved %s\n", path.c_str());
+    } else {
+      printf("Warning: can't save %s\n", path.c_str());
+    }
+  }
+
+  void PaintWindow::OnExportFinished(const std::string& file_name, bool is_ok) {
+    is_exporting_ = false;
+  }
+
+  void PaintWindow::HidePrefPanel() {
+    bool was_deleted = cur_pref_panel_ != nullptr && RemoveChild(cur_pref_panel_);
     assert(was_deleted || cur_pref_panel_ == nullptr);
+    cur_pref_panel_ = nullptr;
+  }
+
+  void PaintWindow::TogglePrefPanel(Plugin::ITool* tool) {
+    HidePrefPanel();
     Plugin::IPreferencesPanel* _panel = pref_panels_[tool];
     if (_panel == nullptr) {
-      cur_pref_panel_ = nullptr;
       return;
     }
     Widget::AbstractContainer* panel = dynamic_cast<Widget::AbstractContainer*>(_panel);
@@ -333,9 +614,16 @@ namespace UserWidget {
 
   PaintWindow::PaintWindow(const Rectangle& pos,
                            Widget::MainWindow* main_window,
-                           Render* render)
+                           Render* render,
+                           const char* file_path)
   : StandardWindow(pos, main_window),
-    cur_pref_panel_(nullptr)
+    main_window_(main_window),
+    render_(render),
+    cur_pref_panel_(nullptr),
+    export_canvas_(arena_.New<Functor::ExportCanvas>(this)),
+    save_canvas_(arena_.New<Functor::SaveCanvas>(this)),
+    is_exporting_(false),
+    tools_rows_count_(0)
   {
     const int x = pos.corner.x;
     const int y = pos.corner.y;
@@ -345,30 +633,37 @@ namespace UserWidget {
     // -------------------------------------------------
     Rectangle canvas_back_pos = {{x + (int)kPaletteWidth, y + (int)kStandardTitlebarHeight}, pos.width - kPaletteWidth, pos.height - kStandardTitlebarHeight};
     Rectangle canvas_pos = {canvas_back_pos.corner + Point2D<int>{(int)kStandardResizeOfs, (int)kStandardResizeOfs}, canvas_back_pos.width - kStandardResizeOfs, canvas_back_pos.height - kStandardResizeOfs};
-    auto canvas = new Widget::Canvas(canvas_pos, main_window, render);
+    auto canvas = new Widget::Canvas(canvas_pos, main_window, render, file_path);
+    canvas_ = canvas;
     AddChild(new Container(canvas_back_pos, {}, kFuncDrawTexBlack));
     AddChild(canvas);
 
     // Creating dropdownlist for filters
     // -------------------------------------------------
-    ::Tool::Manager* manager = ::Tool::Manager::GetInstance();
-    std::list<Plugin::IFilter*> filters = manager->GetFiltersList();
-
-    auto func = new Functor::DropdownListPopUp(nullptr);
+    auto func = arena_.New<Functor::DropdownListPopUp>(nullptr);
     auto filters_button =
     new UserWidget::ButtonOnPressWithText({x, y}, main_window, func, {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra},
                                           render, kWhite}, "Filters");
 
-    auto filters_list =
-    new UserWidget::DropdownList(main_window, this,
-                                 filters_button, 200, kStandardTitlebarHeight, {},
-                                 {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
-    func->SetDropdownList(filters_list);
-    for (auto filter : filters) {
-      filters_list->AddButton({new Functor::ApplyFilter(filter, canvas->GetPaintingArea()), filter->GetName()});
-    }
+    filters_list_ =
+    arena_.New<UserWidget::DropdownList>(main_window, this,
+                                         filters_button, 200, kStandardTitlebarHeight, std::initializer_list<UserWidget::DropdownList::ButtonInfo>{},
+                                         UserWidget::ButtonDrawInfo{{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra}, render, kWhite});
+    func->SetDropdownList(filters_list_);
     AddChild(filters_button);
 
+    auto save_button =
+    new UserWidget::ButtonOnPressWithText({x + (int)filters_button->GetPosition().width, y}, main_window, save_canvas_,
+                                          {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra},
+                                          render, kWhite}, "Save");
+    AddChild(save_button);
+
+    auto export_button =
+    new UserWidget::ButtonOnPressWithText({save_button->GetPosition().corner.x + (int)save_button->GetPosition().width, y}, main_window, export_canvas_,
+                                          {{kFuncDrawTexMainFramed, kFuncDrawTexMainDarkFramed, kFuncDrawTexMainDarkExtra},
+                                          render, kWhite}, "Export");
+    AddChild(export_button);
+
     // Creating palette
     // -------------------------------------------------
     Rectangle palette_back_pos = {{x, (int)(y + kStandardTitlebarHeight)}, kPaletteWidth, pos.height - kStandardTitlebarHeight};
@@ -376,6 +671,9 @@ namespace UserWidget {
     auto palette = new Widget::Container(palette_pos,
                                          {}, kFuncDrawTexMain);
     CreatePalette(palette, render, {x, y + (int)kStandardTitlebarHeight}, main_window);
+    CreateToolsAndFilters();
+    ::Tool::Manager::GetInstance()->AddObserver(this);
+    palette->EnableRenderCache(render);
     AddChild(new Container(palette_back_pos, {}, kFuncDrawTexBlack));
     AddChild(palette);
 
@@ -383,8 +681,8 @@ namespace UserWidget {
     // -------------------------------------------------
     const uint scroll_bar_width = 84;
     const int scroll_ofs = 2;
-    scroll_canvas0_ = new Functor::ScrollCanvas(canvas);
-    scroll_canvas1_ = new Functor::ScrollCanvas(canvas);
+    scroll_canvas0_ = arena_.New<Functor::ScrollCanvas>(canvas);
+    scroll_canvas1_ = arena_.New<Functor::ScrollCanvas>(canvas);
     int c_x = canvas_pos.corner.x;
     int c_y = canvas_pos.corner.y;
     int c_w = canvas_pos.width;
@@ -394,6 +692,11 @@ namespace UserWidget {
 
     AddChild(new Widget::Scroll({{c_x + c_w - (int)kStandardThumbWidth - scroll_ofs, c_y + scroll_ofs}, kStandardThumbWidth, scroll_bar_width},
                                 main_window, kVertical, c_y + scroll_ofs, c_y + c_h - scroll_ofs, scroll_canvas1_, {kFuncDrawVerticalScrollBarNormal, kFuncDrawVerticalScrollBarHover, kFuncDrawVerticalScrollBarClick}));
+
+    shortcuts_.Bind(SDL_SCANCODE_S, KeyboardKeyClickInfo::kCtrl, save_canvas_);
+    shortcuts_.Bind(SDL_SCANCODE_E, KeyboardKeyClickInfo::kCtrl, export_canvas_);
+    // a new window is where the user works next
+    main_window->SetKeyboardFocus(this);
   }
 
   void PaintWindow::ProcessSystemEvent(const SystemEvent& event) {
@@ -402,14 +705,13 @@ namespace UserWidget {
         PushMouseUpToChildInFocus(event);
         break;
 
-      case SystemEvent::kMouseButtonDown:
-        for (auto child : children_) {
-          if (child->IsMouseCoordinatesInBound(event.info.mouse_click.coordinate)) {
-            child->ProcessSystemEvent(event);
-            break;
-          }
+      case SystemEvent::kMouseButtonDown: {
+        Widget::Abstract* child = FindChildAt(event.info.mouse_click.coordinate);
+        if (child != nullptr) {
+          child->ProcessSystemEvent(event);
         }
         break;
+      }
 
       case SystemEvent::kMouseMotion:
         PushMouseMotionToChildInFocus(event);
@@ -417,12 +719,37 @@ namespace UserWidget {
     }
   }
 
+  bool PaintWindow::IsKeyboardFocusable() const {
+    return true;
+  }
+
+  bool PaintWindow::ProcessKey(const SystemEvent& event) {
+    const KeyboardKeyClickInfo& key = event.info.keyboard_key_click;
+    if (event.type != SystemEvent::kKeyboardKeyDown || key.is_repeat) {
+      return false;
+    }
+    Functor::Abstract* func = shortcuts_.Find(key);
+    if (func == nullptr) {
+      return false;
+    }
+    FunctorQueue::GetInstance().Push(func);
+    return true;
+  }
+
   PaintWindow::~PaintWindow() {
-    for (auto t : textures_to_free_) delete t;
-    for (auto f : draw_funcs_to_free_) delete f;
-    for (auto f : pick_color_funcs_to_free_) delete f;
-    for (auto f : set_tool_funcs_to_free_) delete f;
-    delete scroll_canvas0_;
-    delete scroll_canvas1_;
+    ::Tool::Manager::GetInstance()->DeleteObserver(this);
+    Png::Exporter::GetInstance().ForgetObserver(this);
+    // the main bar outlives the window, its buttons would pop up lists
+    // freed with the arena
+    kMainBar->RemoveChild(tools_button_);
+    kMainBar->RemoveChild(colors_button_);
+    delete tools_button_;
+    delete colors_button_;
+    // a list that is shown is also a child of its parent window
+    RemoveChild(filters_list_);
+    main_window_->RemoveChild(tools_list_);
+    main_window_->RemoveChild(colors_list_);
+    // arenas free everything else after this, child widgets go last with
+    // the base class
   }
 }
\ No newline at end of file
@@ -0,0 +1,114 @@
+#include <SDL2/SDL.h>
+#include "../include/DisplayList.h"
+
+DisplayList::DisplayList()
+: page_width_(0), page_height_(0) {}
+
+DisplayList::~DisplayList() {
+  for (auto& command : commands_) {
+    if (command.kind == Command::kOwnedCopy) {
+      SDL_DestroyTexture(command.texture);
+    }
+  }
+}
+
+void DisplayList::AddQuad(SDL_Texture* texture, const Rectangle& src, const Rectangle& dst) {
+  if (commands_.empty() || commands_.back().kind != Command::kQuads ||
+      commands_.back().texture != texture) {
+    int page_width = 0;
+    int page_height = 0;
+    SDL_QueryTexture(texture, NULL, NULL, &page_width, &page_height);
+    page_width_ = (float)page_width;
+    page_height_ = (float)page_height;
+    commands_.push_back({Command::kQuads, texture, {}, {}, vertices_.size(), 0, indices_.size(), 0});
+  }
+
+  Command& command = commands_.back();
+  AppendQuad(&vertices_, &indices_, (int)command.vertices_count, src, dst,
+             page_width_, page_height_);
+  command.vertices_count += 4;
+  command.indices_count += 6;
+}
+
+void DisplayList::AppendQuad(std::vector<SDL_Vertex>* vertices, std::vector<int>* indices,
+                             int base, const Rectangle& src, const Rectangle& dst,
+                             float page_width, float page_height) {
+  const SDL_Color white = {255, 255, 255, 255};
+  float u0 = src.corner.x / page_width;
+  float v0 = src.corner.y / page_height;
+  float u1 = (src.corner.x + (int)src.width) / page_width;
+  float v1 = (src.corner.y + (int)src.height) / page_height;
+  float x0 = dst.corner.x;
+  float y0 = dst.corner.y;
+  float x1 = dst.corner.x + (int)dst.width;
+  float y1 = dst.corner.y + (int)dst.height;
+
+  vertices->push_back({{x0, y0}, white, {u0, v0}});
+  vertices->push_back({{x1, y0}, white, {u1, v0}});
+  vertices->push_back({{x0, y1}, white, {u0, v1}});
+  vertices->push_back({{x1, y1}, white, {u1, v1}});
+  for (int index : {0, 1, 2, 2, 1, 3}) {
+    indices->push_back(base + index);
+  }
+}
+
+void DisplayList::AddOwnedCopy(SDL_Texture* texture, const Rectangle& dst) {
+  commands_.push_back({Command::kOwnedCopy, texture, {}, dst, 0, 0, 0, 0});
+}
+
+void DisplayList::AddPoint(const Point2D<int>& point, const Color& color) {
+  commands_.push_back({Command::kPoint, nullptr, color, {point, 1, 1}, 0, 0, 0, 0});
+}
+
+void DisplayList::AddClear(const Color& color) {
+  // nothing drawn before it would be seen
+  for (auto& command : commands_) {
+    if (command.kind == Command::kOwnedCopy) {
+      SDL_DestroyTexture(command.texture);
+    }
+  }
+  commands_.clear();
+  vertices_.clear();
+  indices_.clear();
+  commands_.push_back({Command::kClear, nullptr, color, {}, 0, 0, 0, 0});
+}
+
+void DisplayList::Submit(SDL_Renderer* render) {
+  SDL_SetRenderTarget(render, nullptr);
+  for (auto& command : commands_) {
+    switch (command.kind) {
+      case Command::kQuads: {
+        // only the command's vertices, SDL transforms every vertex passed
+        SDL_RenderGeometry(render, command.texture,
+                           vertices_.data() + command.first_vertex, (int)command.vertices_count,
+                           indices_.data() + command.first_index, (int)command.indices_count);
+        break;
+      }
+
+      case Command::kOwnedCopy: {
+        SDL_Rect dst = {command.rect.corner.x, command.rect.corner.y,
+                        (int)command.rect.width, (int)command.rect.height};
+        SDL_RenderCopy(render, command.texture, nullptr, &dst);
+        SDL_DestroyTexture(command.texture);
+        break;
+      }
+
+      case Command::kPoint: {
+        const Color& color = command.color;
+        SDL_SetRenderDrawColor(render, color.red, color.green, color.blue, color.alpha);
+        SDL_RenderDrawPoint(render, command.rect.corner.x, command.rect.corner.y);
+        break;
+      }
+
+      case Command::kClear: {
+        const Color& color = command.color;
+        SDL_SetRenderDrawColor(render, color.red, color.green, color.blue, color.alpha);
+        SDL_RenderClear(render);
+        break;
+      }
+    }
+  }
+  commands_.clear();
+  vertices_.clear();
+  indices_.clear();
+}
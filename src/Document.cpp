@@ -0,0 +1,329 @@
+#include <stdio.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#include "../include/Document.h"
+#include "../include/ThreadPool.h"
+
+const char* const Document::kExtension = ".gdoc";
+const char kMagic[4] = {'G', 'D', 'O', 'C'};
+const uint32_t kFormatVersion = 1;
+// a file this many times bigger than its newest revision is compacted
+const uint64_t kCompactionRatio = 4;
+const uint64_t kMinCompactedSize = 1 << 20;
+
+struct Document::Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t width;
+  uint32_t height;
+  uint32_t tile_size;
+  uint32_t reserved;
+  uint64_t table_offset; // the newest table
+};
+
+// followed by tiles_count TileEntry
+struct Document::TableHeader {
+  uint64_t previous_table_offset; // 0 for the first one
+  uint32_t tiles_count;
+  uint32_t reserved;
+};
+
+static uint GetTilesCountIn(uint length) {
+  return (length + Document::kTileSize - 1) / Document::kTileSize;
+}
+
+static bool WriteAll(int fd, const void* data, size_t size, uint64_t offset) {
+  return pwrite(fd, data, size, (off_t)offset) == (ssize_t)size;
+}
+
+// an empty result stands for a transparent tile
+static std::vector<unsigned char> CompressTile(const std::vector<uint>& pixels) {
+  bool is_transparent = true;
+  for (uint pixel : pixels) {
+    if (pixel != 0) {
+      is_transparent = false;
+      break;
+    }
+  }
+  if (is_transparent) {
+    return {};
+  }
+  uLong size = pixels.size() * sizeof(uint);
+  uLongf compressed_size = compressBound(size);
+  std::vector<unsigned char> compressed(compressed_size);
+  int res = compress2(compressed.data(), &compressed_size,
+                      (const Bytef*)pixels.data(), size, Z_BEST_SPEED);
+  assert(res == Z_OK);
+  compressed.resize(compressed_size);
+  return compressed;
+}
+
+Document::Document(const std::string& path, int fd, uint width, uint height)
+: path_(path), fd_(fd), mapping_(nullptr), mapped_size_(0),
+  width_(width), height_(height), table_offset_(0),
+  table_((size_t)GetTilesCountIn(width) * GetTilesCountIn(height), TileEntry{0, 0, 0}) {}
+
+bool Document::WriteHeader(int fd, uint width, uint height, uint64_t table_offset) {
+  Header header = {{}, kFormatVersion, width, height, kTileSize, 0, table_offset};
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  return WriteAll(fd, &header, sizeof(header), 0);
+}
+
+Document::~Document() {
+  if (mapping_ != nullptr) {
+    munmap((void*)mapping_, mapped_size_);
+  }
+  close(fd_);
+}
+
+Document* Document::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  Header header = {};
+  if (pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.version != kFormatVersion || header.tile_size != kTileSize ||
+      header.width == 0 || header.height == 0) {
+    close(fd);
+    return nullptr;
+  }
+  // the table is allocated before it's read, a damaged header mustn't make
+  // it bigger than the file could hold
+  struct stat file_stat = {};
+  uint64_t tiles_count = (uint64_t)GetTilesCountIn(header.width) * GetTilesCountIn(header.height);
+  if (fstat(fd, &file_stat) != 0 || (uint64_t)file_stat.st_size < sizeof(Header) ||
+      tiles_count > ((uint64_t)file_stat.st_size - sizeof(Header)) / sizeof(TileEntry)) {
+    close(fd);
+    return nullptr;
+  }
+
+  Document* document = new Document(path, fd, header.width, header.height);
+  document->table_offset_ = header.table_offset;
+  if (!document->Map() || !document->ReadTable()) {
+    delete document;
+    return nullptr;
+  }
+  return document;
+}
+
+Document* Document::Create(const std::string& path, uint width, uint height) {
+  assert(width > 0 && height > 0);
+  // another document may have the file open, it's never truncated
+  int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (!WriteHeader(fd, width, height, 0)) {
+    close(fd);
+    return nullptr;
+  }
+
+  Document* document = new Document(path, fd, width, height);
+  // writes the first table, all tiles transparent
+  if (!document->Save({})) {
+    delete document;
+    return nullptr;
+  }
+  return document;
+}
+
+bool Document::Map() {
+  if (mapping_ != nullptr) {
+    munmap((void*)mapping_, mapped_size_);
+    mapping_ = nullptr;
+  }
+  struct stat file_stat = {};
+  if (fstat(fd_, &file_stat) != 0) {
+    return false;
+  }
+  void* mapping = mmap(nullptr, file_stat.st_size, PROT_READ, MAP_SHARED, fd_, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+  mapping_ = (const unsigned char*)mapping;
+  mapped_size_ = file_stat.st_size;
+  return true;
+}
+
+bool Document::ReadTable() {
+  // offsets come from the file, sums of them could wrap around
+  TableHeader table_header = {};
+  if (table_offset_ > mapped_size_ || mapped_size_ - table_offset_ < sizeof(table_header)) {
+    return false;
+  }
+  memcpy(&table_header, mapping_ + table_offset_, sizeof(table_header));
+  size_t table_size = table_.size() * sizeof(TileEntry);
+  if (table_header.tiles_count != table_.size() ||
+      mapped_size_ - table_offset_ - sizeof(table_header) < table_size) {
+    return false;
+  }
+  memcpy(table_.data(), mapping_ + table_offset_ + sizeof(table_header), table_size);
+  for (auto& entry : table_) {
+    if (entry.offset > mapped_size_ || mapped_size_ - entry.offset < entry.size) {
+      return false;
+    }
+  }
+  return true;
+}
+
+const std::string& Document::GetPath() const {
+  return path_;
+}
+
+uint Document::GetWidth() const {
+  return width_;
+}
+
+uint Document::GetHeight() const {
+  return height_;
+}
+
+uint Document::GetTilesCount() const {
+  return (uint)table_.size();
+}
+
+uint Document::GetTilesCountX() const {
+  return GetTilesCountIn(width_);
+}
+
+Rectangle Document::GetTileRect(uint index) const {
+  assert(index < table_.size());
+  uint x = index % GetTilesCountX() * kTileSize;
+  uint y = index / GetTilesCountX() * kTileSize;
+  return {{(int)x, (int)y}, Min(kTileSize, width_ - x), Min(kTileSize, height_ - y)};
+}
+
+bool Document::ReadTile(uint index, uint* pixels) const {
+  Rectangle rect = GetTileRect(index);
+  uLongf size = (uLongf)rect.width * rect.height * sizeof(uint);
+  const TileEntry& entry = table_[index];
+  if (entry.offset == 0) {
+    memset(pixels, 0, size);
+    return true;
+  }
+  uLongf decompressed_size = size;
+  return uncompress((Bytef*)pixels, &decompressed_size,
+                    mapping_ + entry.offset, entry.size) == Z_OK &&
+         decompressed_size == size;
+}
+
+bool Document::Save(const std::vector<Tile>& tiles, bool in_parallel) {
+  std::vector<std::vector<unsigned char>> compressed;
+  if (in_parallel) {
+    std::vector<std::future<std::vector<unsigned char>>> compressing;
+    for (auto& tile : tiles) {
+      assert(tile.index < table_.size());
+      const std::vector<uint>* pixels = &tile.pixels;
+      compressing.push_back(ThreadPool::GetInstance().Submit([pixels]() {
+        return CompressTile(*pixels);
+      }));
+    }
+    // all jobs are finished before anything can fail, they read tiles
+    for (auto& future : compressing) {
+      compressed.push_back(future.get());
+    }
+  } else {
+    // a job waiting for other jobs of the pool could wait forever
+    for (auto& tile : tiles) {
+      assert(tile.index < table_.size());
+      compressed.push_back(CompressTile(tile.pixels));
+    }
+  }
+
+  struct stat file_stat = {};
+  if (fstat(fd_, &file_stat) != 0) {
+    return false;
+  }
+  uint64_t offset = file_stat.st_size;
+  std::vector<TileEntry> table = table_;
+  for (size_t i = 0; i < tiles.size(); ++i) {
+    TileEntry& entry = table[tiles[i].index];
+    if (compressed[i].empty()) {
+      entry = {0, 0, 0};
+      continue;
+    }
+    if (!WriteAll(fd_, compressed[i].data(), compressed[i].size(), offset)) {
+      return false;
+    }
+    entry = {offset, (uint32_t)compressed[i].size(), 0};
+    offset += compressed[i].size();
+  }
+
+  TableHeader table_header = {table_offset_, (uint32_t)table.size(), 0};
+  uint64_t table_offset = offset;
+  if (!WriteAll(fd_, &table_header, sizeof(table_header), table_offset) ||
+      !WriteAll(fd_, table.data(), table.size() * sizeof(TileEntry),
+                table_offset + sizeof(table_header))) {
+    return false;
+  }
+  // the new table must be on disk before the header points at it
+  if (fdatasync(fd_) != 0 ||
+      !WriteAll(fd_, &table_offset, sizeof(table_offset), offsetof(Header, table_offset))) {
+    return false;
+  }
+
+  table_ = table;
+  table_offset_ = table_offset;
+  if (!Map()) {
+    return false;
+  }
+  if (mapped_size_ > kMinCompactedSize &&
+      mapped_size_ > kCompactionRatio * GetRevisionSize() && !Compact()) {
+    printf("Warning: can't compact %s\n", path_.c_str());
+  }
+  return mapping_ != nullptr;
+}
+
+uint64_t Document::GetRevisionSize() const {
+  uint64_t size = sizeof(Header) + sizeof(TableHeader) + table_.size() * sizeof(TileEntry);
+  for (auto& entry : table_) {
+    size += entry.size;
+  }
+  return size;
+}
+
+bool Document::Compact() {
+  // written next to the file and renamed over it, a crash leaves either
+  // the old file or the complete new one
+  std::string temp_path = path_ + ".tmp";
+  int fd = open(temp_path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  std::vector<TileEntry> table = table_;
+  uint64_t offset = sizeof(Header);
+  bool is_ok = true;
+  for (auto& entry : table) {
+    if (entry.offset == 0) {
+      continue;
+    }
+    if (!WriteAll(fd, mapping_ + entry.offset, entry.size, offset)) {
+      is_ok = false;
+      break;
+    }
+    entry.offset = offset;
+    offset += entry.size;
+  }
+  TableHeader table_header = {0, (uint32_t)table.size(), 0};
+  is_ok = is_ok && WriteAll(fd, &table_header, sizeof(table_header), offset) &&
+          WriteAll(fd, table.data(), table.size() * sizeof(TileEntry), offset + sizeof(table_header)) &&
+          WriteHeader(fd, width_, height_, offset) && fsync(fd) == 0 &&
+          rename(temp_path.c_str(), path_.c_str()) == 0;
+  if (!is_ok) {
+    close(fd);
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  close(fd_);
+  fd_ = fd;
+  table_ = table;
+  table_offset_ = offset;
+  return Map();
+}
@@ -29,7 +29,7 @@ namespace UserWidget {
     button_height_(button_height),
     button_draw_info_(button_draw_info),
     is_visible_(false),
-    hover_listener_(nullptr),
+    hover_listener_(this),
     func_(new Functor::DropdownListClose(this))
   {
     Rectangle pos = button_toggler_->GetPosition();
@@ -45,30 +45,43 @@ namespace UserWidget {
     auto b = new BasicButtonWithText({{x, y}, button_width_, button_height_},
                                      main_window_, button.func, button_draw_info_,
                                      button.text);
+    b->SetParent(this);
     button_list_.push_back(b);
     position_.height += button_height_;
+    OnPositionChanged();
+  }
+
+  void DropdownList::Clear() {
+    if (hover_listener_.IsListening()) {
+      StopListeningMouseMotion();
+    } else {
+      Hide();
+    }
+    for (auto button : button_list_) {
+      delete button;
+    }
+    button_list_.clear();
+    position_.height = 0;
+    OnPositionChanged();
+    Invalidate();
   }
 
   DropdownList::~DropdownList() {
     for (auto button : button_list_) {
       delete button;
     }
-    if (hover_listener_ != nullptr) {
-      main_window_->DeleteListener(SystemEvent::kMouseButtonUp, hover_listener_);
-      delete hover_listener_;
+    if (hover_listener_.IsListening()) {
+      main_window_->DeleteListener(&hover_listener_);
     }
     delete func_;
   }
 
   void DropdownList::StartListeningMouseMotion() {
-    hover_listener_ = new Listener::DropdownList(this);
-    main_window_->AddListener(SystemEvent::kMouseMotion, hover_listener_);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &hover_listener_);
   }
 
   void DropdownList::StopListeningMouseMotion() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, hover_listener_);
-    delete hover_listener_;
-    hover_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &hover_listener_);
     Hide();
   }
 
@@ -89,6 +102,9 @@ namespace UserWidget {
   }
 
   void DropdownList::ProcessSystemEvent(const SystemEvent& event) {
+    if (button_list_.empty()) {
+      return;
+    }
     switch (event.type) {
       case SystemEvent::kMouseButtonDown: {
         Point2D<int> mc = static_cast<Point2D<int>>(event.info.mouse_click.coordinate);
@@ -101,7 +117,7 @@ namespace UserWidget {
         Point2D<int> mc = static_cast<Point2D<int>>(event.info.mouse_motion.new_mouse_pos);
         uint idx = Min((uint)button_list_.size() - 1, (uint)(mc.y - position_.corner.y) / button_height_);
         button_list_[idx]->ProcessSystemEvent(event);
-        if (hover_listener_ == nullptr) {
+        if (!hover_listener_.IsListening()) {
           StartListeningMouseMotion();
         } // else it's already processed by listener
       }
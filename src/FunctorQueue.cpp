@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <algorithm>
+#include <SDL2/SDL.h>
+#include "../include/FunctorQueue.h"
+
+static_assert((FunctorQueue::kCapacity & (FunctorQueue::kCapacity - 1)) == 0,
+              "positions are mapped to slots with a mask");
+
+FunctorQueue::FunctorQueue()
+: push_pos_(0), pop_pos_(0), owner_(std::this_thread::get_id()),
+  is_wake_pending_(false),
+  wake_event_type_(SDL_RegisterEvents(1)),
+  coalesced_pushes_(0), merged_pushes_(0)
+{
+  for (size_t i = 0; i < kCapacity; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+    slots_[i].func = nullptr;
+  }
+}
+
+bool FunctorQueue::TryPush(Functor::Abstract* func) {
+  size_t pos = push_pos_.load(std::memory_order_relaxed);
+  while (true) {
+    Slot& slot = slots_[pos & (kCapacity - 1)];
+    size_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence == pos) {
+      // the slot is free, claim it unless another thread was faster
+      if (push_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        slot.func = func;
+        slot.sequence.store(pos + 1, std::memory_order_release);
+        return true;
+      }
+    } else if (sequence < pos) {
+      // the slot still holds the functor pushed a whole ring ago
+      return false;
+    } else {
+      pos = push_pos_.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+void FunctorQueue::Push(Functor::Abstract* func) {
+  assert(func != nullptr);
+  if (std::this_thread::get_id() == owner_) {
+    // once something is aside, the rest goes after it to keep the order
+    if (!overflow_.empty() || !TryPush(func)) {
+      overflow_.push_back(func);
+    }
+    return;
+  }
+  while (!TryPush(func)) {
+    std::this_thread::yield();
+  }
+  Wake();
+}
+
+void FunctorQueue::PushCoalesced(Functor::Abstract* func) {
+  assert(std::this_thread::get_id() == owner_);
+  ++coalesced_pushes_;
+  if (std::find(coalesced_.begin(), coalesced_.end(), func) != coalesced_.end()) {
+    ++merged_pushes_;
+    return;
+  }
+  coalesced_.push_back(func);
+  Push(func);
+}
+
+Functor::Abstract* FunctorQueue::Pop() {
+  assert(std::this_thread::get_id() == owner_);
+  // cleared before popping: a push after this sends a new wakeup, a push
+  // before it is popped below
+  is_wake_pending_.store(false, std::memory_order_seq_cst);
+  Functor::Abstract* func = nullptr;
+  Slot& slot = slots_[pop_pos_ & (kCapacity - 1)];
+  if (slot.sequence.load(std::memory_order_acquire) == pop_pos_ + 1) {
+    func = slot.func;
+    slot.sequence.store(pop_pos_ + kCapacity, std::memory_order_release);
+    ++pop_pos_;
+  } else if (!overflow_.empty()) {
+    func = overflow_.front();
+    overflow_.erase(overflow_.begin());
+  } else {
+    return nullptr;
+  }
+  // pushes made while it runs go to the next drain
+  auto it = std::find(coalesced_.begin(), coalesced_.end(), func);
+  if (it != coalesced_.end()) {
+    coalesced_.erase(it);
+  }
+  return func;
+}
+
+void FunctorQueue::WaitIdle(uint timeout_ms) {
+  assert(std::this_thread::get_id() == owner_);
+  // the event stays in SDL's queue, the next poll takes it out
+  SDL_WaitEventTimeout(nullptr, (int)timeout_ms);
+}
+
+void FunctorQueue::Wake() {
+  if (is_wake_pending_.exchange(true, std::memory_order_seq_cst)) {
+    return;
+  }
+  // SDL_PushEvent may be called from any thread
+  SDL_Event event = {};
+  event.type = wake_event_type_;
+  SDL_PushEvent(&event);
+}
+
+void FunctorQueue::PrintStats() const {
+  printf("Functor queue: %u coalesced pushes, %u merged\n",
+         coalesced_pushes_, merged_pushes_);
+}
@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <png.h>
+#include "../include/ImageImport.h"
+#include "../include/Plugin.h"
+#include "../include/ThreadPool.h"
+#include "../include/FunctorQueue.h"
+
+// rows decoded between two uploads: big enough that a 50 MP scan isn't
+// uploaded in thousands of pieces, small enough to show progress early
+const uint kBandRowsCount = 256;
+
+// decoder state shared by ReadSize and Decode, destroyed on any exit
+struct PngReader {
+  FILE* file = nullptr;
+  png_structp png = nullptr;
+  png_infop info = nullptr;
+
+  ~PngReader() {
+    if (png != nullptr) {
+      png_destroy_read_struct(&png, &info, nullptr);
+    }
+    if (file != nullptr) {
+      fclose(file);
+    }
+  }
+};
+
+static bool OpenPng(const char* file_name, PngReader* reader) {
+  reader->file = fopen(file_name, "rb");
+  if (reader->file == nullptr) {
+    return false;
+  }
+  png_byte signature[8] = {};
+  if (fread(signature, 1, sizeof(signature), reader->file) != sizeof(signature) ||
+      png_sig_cmp(signature, 0, sizeof(signature)) != 0) {
+    return false;
+  }
+  reader->png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+  if (reader->png == nullptr) {
+    return false;
+  }
+  reader->info = png_create_info_struct(reader->png);
+  return reader->info != nullptr;
+}
+
+// whatever the format of the file, rows come out as 8-bit RGBA
+static int SetRgbaTransforms(png_structp png, png_infop info) {
+  png_set_expand(png);
+  png_set_strip_16(png);
+  png_set_gray_to_rgb(png);
+  png_set_add_alpha(png, 0xFF, PNG_FILLER_AFTER);
+  int passes_count = png_set_interlace_handling(png);
+  png_read_update_info(png, info);
+  return passes_count;
+}
+
+// RGBA bytes -> RGBA8888 pixels of the textures
+static void ConvertRows(const png_byte* rows, uint width, uint rows_count, uint* pixels) {
+  for (size_t i = 0; i < (size_t)width * rows_count; ++i) {
+    const png_byte* src = rows + 4 * i;
+    pixels[i] = ((uint)src[0] << 24) | ((uint)src[1] << 16) | ((uint)src[2] << 8) | (uint)src[3];
+  }
+}
+
+bool ImageImport::ReadSize(const char* file_name, uint* width, uint* height) {
+  PngReader reader;
+  if (!OpenPng(file_name, &reader) || setjmp(png_jmpbuf(reader.png))) {
+    return false;
+  }
+  png_init_io(reader.png, reader.file);
+  png_set_sig_bytes(reader.png, 8);
+  png_read_info(reader.png, reader.info);
+  *width = png_get_image_width(reader.png, reader.info);
+  *height = png_get_image_height(reader.png, reader.info);
+  return true;
+}
+
+ImageImport::ImageImport(const std::string& file_name, Plugin::Texture* canvas)
+: file_name_(file_name), canvas_(canvas), is_cancelled_(false),
+  is_finished_(false)
+{
+  is_decoded_ = ThreadPool::GetInstance().Submit([this]() {
+    return Decode();
+  });
+}
+
+ImageImport::~ImageImport() {
+  is_cancelled_ = true;
+  if (is_decoded_.valid()) {
+    is_decoded_.wait();
+  }
+}
+
+void ImageImport::PushBand(Band&& band) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded_.push_back(std::move(band));
+  }
+  // bands are taken by the canvas every frame, an idle loop has to wake
+  FunctorQueue::GetInstance().Wake();
+}
+
+// Runs on the ThreadPool
+bool ImageImport::Decode() {
+  PngReader reader;
+  // the whole image for interlaced files, one band otherwise
+  std::vector<png_byte> rows;
+  if (!OpenPng(file_name_.c_str(), &reader) || setjmp(png_jmpbuf(reader.png))) {
+    return false;
+  }
+  png_init_io(reader.png, reader.file);
+  png_set_sig_bytes(reader.png, 8);
+  png_read_info(reader.png, reader.info);
+  uint width = png_get_image_width(reader.png, reader.info);
+  uint height = png_get_image_height(reader.png, reader.info);
+  int passes_count = SetRgbaTransforms(reader.png, reader.info);
+  size_t row_size = (size_t)width * 4;
+
+  if (passes_count == 1) {
+    rows.resize(row_size * kBandRowsCount);
+    for (uint y = 0; y < height; y += kBandRowsCount) {
+      if (is_cancelled_) {
+        return false;
+      }
+      uint rows_count = Min(kBandRowsCount, height - y);
+      for (uint i = 0; i < rows_count; ++i) {
+        png_read_row(reader.png, rows.data() + i * row_size, nullptr);
+      }
+      Band band = {y, rows_count, width, std::vector<uint>((size_t)width * rows_count)};
+      ConvertRows(rows.data(), width, rows_count, band.pixels.data());
+      PushBand(std::move(band));
+    }
+    return true;
+  }
+
+  // rows of an interlaced image are complete only after the last pass
+  rows.resize(row_size * height);
+  for (int pass = 0; pass < passes_count; ++pass) {
+    for (uint y = 0; y < height; ++y) {
+      if (is_cancelled_) {
+        return false;
+      }
+      png_read_row(reader.png, rows.data() + y * row_size, nullptr);
+    }
+  }
+  for (uint y = 0; y < height; y += kBandRowsCount) {
+    uint rows_count = Min(kBandRowsCount, height - y);
+    Band band = {y, rows_count, width, std::vector<uint>((size_t)width * rows_count)};
+    ConvertRows(rows.data() + y * row_size, width, rows_count, band.pixels.data());
+    PushBand(std::move(band));
+  }
+  return true;
+}
+
+void ImageImport::UploadDecoded() {
+  std::vector<Band> decoded;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoded.swap(decoded_);
+  }
+  for (auto& band : decoded) {
+    Rectangle region = {{0, (int)band.first_row}, band.width, band.rows_count};
+    canvas_->WritePixels(band.pixels.data(), region);
+    // the image file is kept, so it isn't an unsaved change, but the first
+    // snapshot must have it: it's recovered without the file
+    canvas_->MarkTilesChanged(region);
+  }
+}
+
+bool ImageImport::IsFinished() {
+  if (is_finished_) {
+    return true;
+  }
+  if (is_decoded_.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+    return false;
+  }
+  if (!is_decoded_.get()) {
+    printf("Warning: can't read %s\n", file_name_.c_str());
+  }
+  UploadDecoded();
+  is_finished_ = true;
+  return true;
+}
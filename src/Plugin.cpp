@@ -1,4 +1,5 @@
 #include <SDL2/SDL.h>
+#include <dlfcn.h>
 #include "../include/Plugin.h"
 #include "../include/Render.h"
 
@@ -10,10 +11,12 @@ const uint kDefaultButtonWidth = kStandardButtonWidth;
 namespace Plugin {
   Texture::Texture(uint width, uint height, Render* render,
   	               const ::Color& color)
-  : texture_(width, height, render, color), render_(render) {}
+  : texture_(width, height, render, color), render_(render),
+    tile_size_(0), tiles_count_x_(0), changes_count_(0) {}
 
   Texture::Texture(const char* image_name, Render* render)
-  : texture_(image_name, render) {}
+  : texture_(image_name, render), render_(render),
+    tile_size_(0), tiles_count_x_(0), changes_count_(0) {}
 
   uint Texture::GetWidth() {
   	return texture_.GetWidth();
@@ -23,17 +26,32 @@ namespace Plugin {
   	return texture_.GetHeight();
   }
 
-  Buffer Texture::ReadBuffer() {
-    Color* buffer = new Color[GetWidth() * GetHeight()];
+  void Texture::ReadPixels(Color* pixels) {
     SDL_SetRenderTarget(render_->render_, texture_.texture_);
     assert(!SDL_RenderReadPixels(render_->render_, NULL, SDL_PIXELFORMAT_RGBA8888,
-                                 buffer, GetWidth() * sizeof(Color)));
-    // for (uint y = 0; y < GetHeight(); ++y) {
-    //   for (uint x = 0; x < GetWidth(); ++x) {
-    //     uint p = buffer[y * GetHeight() + x];
-    //     buffer[y * GetHeight() + x] = InvertttColor(p);
-    //   }
-    // }
+                                 pixels, GetWidth() * sizeof(Color)));
+  }
+
+  void Texture::ReadPixels(Color* pixels, const Rectangle& region) {
+    SDL_Rect rect = {region.corner.x, region.corner.y, (int)region.width, (int)region.height};
+    SDL_SetRenderTarget(render_->render_, texture_.texture_);
+    assert(!SDL_RenderReadPixels(render_->render_, &rect, SDL_PIXELFORMAT_RGBA8888,
+                                 pixels, region.width * sizeof(Color)));
+  }
+
+  void Texture::WritePixels(const Color* pixels) {
+    assert(!SDL_UpdateTexture(texture_.texture_, NULL, pixels, GetWidth() * sizeof(Color)));
+    MarkChanged({{0, 0}, GetWidth(), GetHeight()});
+  }
+
+  void Texture::WritePixels(const Color* pixels, const Rectangle& region) {
+    SDL_Rect rect = {region.corner.x, region.corner.y, (int)region.width, (int)region.height};
+    assert(!SDL_UpdateTexture(texture_.texture_, &rect, pixels, region.width * sizeof(Color)));
+  }
+
+  Buffer Texture::ReadBuffer() {
+    Color* buffer = new Color[GetWidth() * GetHeight()];
+    ReadPixels(buffer);
     return {buffer, this};
   }
 
@@ -42,17 +60,12 @@ namespace Plugin {
   }
 
   void Texture::LoadBuffer(Buffer buffer) {
-    // for (uint y = 0; y < GetHeight(); ++y) {
-    //   for (uint x = 0; x < GetWidth(); ++x) {
-    //     uint p = buffer.pixels[y * GetHeight() + x];
-    //     buffer.pixels[y * GetHeight() + x] = InvertColor(p);
-    //   }
-    // }
-    assert(!SDL_UpdateTexture(texture_.texture_, NULL, buffer.pixels, GetWidth() * sizeof(Color)));
+    WritePixels(buffer.pixels);
   }
 
   void Texture::Clear(Color color) {
     texture_.SetBackgroundColor(GetColor(color));
+    MarkChanged({{0, 0}, GetWidth(), GetHeight()});
   }
 
   void Texture::DrawLine(const Line& line) {
@@ -60,19 +73,27 @@ namespace Plugin {
                            Point2D<int>{line.x1, line.y1},
                            line.thickness,
                            GetColor(line.color));
+    int thickness = (int)line.thickness;
+    MarkChanged({{Min(line.x0, line.x1) - thickness, Min(line.y0, line.y1) - thickness},
+                 (uint)(abs(line.x1 - line.x0) + 2 * thickness + 1),
+                 (uint)(abs(line.y1 - line.y0) + 2 * thickness + 1)});
   }
 
   void Texture::DrawCircle(const Circle& circle) {
     texture_.DrawCircle(Point2D<int>{circle.x, circle.y}, circle.radius, GetColor(circle.fill_color));
+    int radius = (int)circle.radius;
+    MarkChanged({{circle.x - radius, circle.y - radius}, 2 * circle.radius + 1, 2 * circle.radius + 1});
   }
 
   void Texture::DrawRect(const Rect& rect) {
     texture_.DrawRect({{rect.x, rect.y}, rect.width, rect.height}, GetColor(rect.fill_color));
+    MarkChanged({{rect.x, rect.y}, rect.width, rect.height});
   }
 
   void Texture::CopyTexture(ITexture* source, int x, int y, uint width, uint height) {
     Rectangle dst = {{x, y}, width, height};
     texture_.CopyTexture(dynamic_cast<Texture*>(source)->texture_, &dst);
+    MarkChanged(dst);
   }
 
   void Texture::CopyTexture(ITexture* source, int x, int y) {
@@ -83,6 +104,72 @@ namespace Plugin {
     texture_.DrawWithNoScale(&position, src);
   }
 
+  bool Texture::SaveToPNG(const char* file_name) {
+    return texture_.SaveToPNG(file_name);
+  }
+
+  void Texture::TrackChangedTiles(uint tile_size) {
+    assert(tile_size > 0);
+    tile_size_ = tile_size;
+    tiles_count_x_ = (GetWidth() + tile_size - 1) / tile_size;
+    uint tiles_count_y = (GetHeight() + tile_size - 1) / tile_size;
+    changed_tiles_.assign(tiles_count_x_ * tiles_count_y, false);
+    unsaved_tiles_.assign(tiles_count_x_ * tiles_count_y, false);
+  }
+
+  void Texture::MarkChanged(const Rectangle& region) {
+    ++changes_count_;
+    MarkTilesChanged(region);
+  }
+
+  void Texture::MarkTilesChanged(const Rectangle& region) {
+    if (tile_size_ == 0) {
+      return;
+    }
+    int x0 = Max(region.corner.x, 0);
+    int y0 = Max(region.corner.y, 0);
+    int x1 = Min(region.corner.x + (int)region.width, (int)GetWidth());
+    int y1 = Min(region.corner.y + (int)region.height, (int)GetHeight());
+    if (x0 >= x1 || y0 >= y1) {
+      return;
+    }
+    for (uint ty = (uint)y0 / tile_size_; ty <= (uint)(y1 - 1) / tile_size_; ++ty) {
+      for (uint tx = (uint)x0 / tile_size_; tx <= (uint)(x1 - 1) / tile_size_; ++tx) {
+        changed_tiles_[ty * tiles_count_x_ + tx] = true;
+        unsaved_tiles_[ty * tiles_count_x_ + tx] = true;
+      }
+    }
+  }
+
+  std::vector<uint> Texture::TakeChangedTiles() {
+    std::vector<uint> changed;
+    for (uint i = 0; i < changed_tiles_.size(); ++i) {
+      if (changed_tiles_[i]) {
+        changed.push_back(i);
+        changed_tiles_[i] = false;
+      }
+    }
+    return changed;
+  }
+
+  std::vector<uint> Texture::GetUnsavedTiles() const {
+    std::vector<uint> unsaved;
+    for (uint i = 0; i < unsaved_tiles_.size(); ++i) {
+      if (unsaved_tiles_[i]) {
+        unsaved.push_back(i);
+      }
+    }
+    return unsaved;
+  }
+
+  void Texture::MarkTilesSaved() {
+    unsaved_tiles_.assign(unsaved_tiles_.size(), false);
+  }
+
+  uint64_t Texture::GetChangesCount() const {
+    return changes_count_;
+  }
+
   TextureFactory::TextureFactory(Render* render)
   : render_(render) {}
 
@@ -183,6 +270,7 @@ namespace Plugin {
     assert(pos <= 1);
     int w = position_.width;
     position_.corner.x = bound0_ + (int)(pos * (float)(bound1_ - bound0_ - w));
+    OnPositionChanged();
   }
 
   uint Slider::GetWidth() {
@@ -218,8 +306,9 @@ namespace Plugin {
   void Icon::SetIcon(const ITexture* icon) {
     $;
     delete draw_func_;
+    draw_func_ = nullptr;
     ITexture* _icon = const_cast<ITexture*>(icon);
-    draw_func_ = new DrawFunctor::ScalableTexture(&(dynamic_cast<Texture*>(_icon)->texture_));
+    SetDrawFunc(new DrawFunctor::ScalableTexture(&(dynamic_cast<Texture*>(_icon)->texture_)));
     $$;
   }
 
@@ -318,7 +407,26 @@ namespace Plugin {
   }
 
   IPalette* WidgetFactory::CreatePalette() {
-    return new Palette;
+    return new Palette();
+  }
+
+  void WidgetFactory::ForgetPalettesOf(const void* library_address) {
+    Dl_info library = {};
+    if (dladdr(library_address, &library) == 0) {
+      return;
+    }
+    for (auto it = palettes_.begin(); it != palettes_.end();) {
+      // the vtable of a callback (its first word) lives in the library
+      // that implements it
+      Dl_info callback = {};
+      if ((*it)->callback_ != nullptr &&
+          dladdr(*(const void* const*)(*it)->callback_, &callback) != 0 &&
+          callback.dli_fbase == library.dli_fbase) {
+        it = palettes_.erase(it);
+      } else {
+        ++it;
+      }
+    }
   }
 
   IPreferencesPanel* WidgetFactory::CreatePreferencesPanel() {
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <png.h>
+#include "../include/PngExport.h"
+#include "../include/Plugin.h"
+#include "../include/ThreadPool.h"
+#include "../include/FunctorQueue.h"
+
+// zlib level 1..9: the default 6 is several times slower for a few
+// percent smaller files
+const int kCompressionLevel = 3;
+
+namespace Png {
+  class DeliverFinishedExports : public Functor::Abstract {
+   public:
+    void Action() override {
+      Exporter::GetInstance().DeliverFinished();
+    }
+  };
+
+  static DeliverFinishedExports kDeliverFinishedExports;
+
+  bool Write(const char* file_name, const uint* pixels,
+             uint width, uint height) {
+    FILE* file = fopen(file_name, "wb");
+    if (file == nullptr) {
+      return false;
+    }
+    png_structp png = png_create_write_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png == nullptr ? nullptr : png_create_info_struct(png);
+    std::vector<png_byte> row(width * 4);
+    if (info == nullptr || setjmp(png_jmpbuf(png))) {
+      png_destroy_write_struct(&png, &info);
+      fclose(file);
+      remove(file_name);
+      return false;
+    }
+
+    png_init_io(png, file);
+    png_set_compression_level(png, kCompressionLevel);
+    png_set_IHDR(png, info, width, height, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(png, info);
+    for (uint y = 0; y < height; ++y) {
+      const uint* src = pixels + (size_t)y * width;
+      for (uint x = 0; x < width; ++x) {
+        row[4 * x + 0] = (png_byte)(src[x] >> 24);
+        row[4 * x + 1] = (png_byte)(src[x] >> 16);
+        row[4 * x + 2] = (png_byte)(src[x] >> 8);
+        row[4 * x + 3] = (png_byte)(src[x]);
+      }
+      png_write_row(png, row.data());
+    }
+    png_write_end(png, nullptr);
+    png_destroy_write_struct(&png, &info);
+    return fclose(file) == 0;
+  }
+
+  Exporter::Exporter() {
+    // the pool must outlive the exporter, whose destructor waits for jobs
+    ThreadPool::GetInstance();
+  }
+
+  Exporter::~Exporter() {
+    for (auto& job : jobs_) {
+      job.is_ok.wait();
+    }
+  }
+
+  void Exporter::Export(Plugin::Texture* texture, const std::string& file_name,
+                        ExportObserver* observer) {
+    uint width = texture->GetWidth();
+    uint height = texture->GetHeight();
+    std::vector<Plugin::Color> pixels((size_t)width * height);
+    texture->ReadPixels(pixels.data());
+
+    auto is_finished = std::make_shared<std::atomic<bool>>(false);
+    std::future<bool> is_ok = ThreadPool::GetInstance().Submit(
+      [file_name, width, height, pixels = std::move(pixels), is_finished]() {
+        bool is_ok = Write(file_name.c_str(), pixels.data(), width, height);
+        *is_finished = true;
+        FunctorQueue::GetInstance().Push(&kDeliverFinishedExports);
+        return is_ok;
+      });
+    jobs_.push_back({file_name, observer, std::move(is_ok), is_finished});
+  }
+
+  void Exporter::DeliverFinished() {
+    for (size_t i = 0; i < jobs_.size();) {
+      Job& job = jobs_[i];
+      if (!*job.is_finished) {
+        ++i;
+        continue;
+      }
+      bool is_ok = job.is_ok.get();
+      if (is_ok) {
+        printf("Saved %s\n", job.file_name.c_str());
+      } else {
+        printf("Warning: can't save %s\n", job.file_name.c_str());
+      }
+      // the observer may start another export from the callback
+      Job finished = std::move(job);
+      jobs_.erase(jobs_.begin() + i);
+      if (finished.observer != nullptr) {
+        finished.observer->OnExportFinished(finished.file_name, is_ok);
+      }
+    }
+  }
+
+  void Exporter::ForgetObserver(ExportObserver* observer) {
+    for (auto& job : jobs_) {
+      if (job.observer == observer) {
+        job.observer = nullptr;
+      }
+    }
+  }
+
+  bool Exporter::IsExporting() const {
+    return !jobs_.empty();
+  }
+}
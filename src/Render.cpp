@@ -1,10 +1,14 @@
 #include <SDL2/SDL_ttf.h>
+#include <SDL2/SDL_image.h>
 #include "../include/Render.h"
+#include "../include/Texture.h"
 #include "../include/GLWindow.h"
 #include "../include/GUIConstants.h"
 
 Render::Render(const GLWindow& window) {
   assert(TTF_Init() >= 0);
+  // initialized up front since images are decoded from several threads
+  IMG_Init(IMG_INIT_PNG | IMG_INIT_JPG);
   char temp[100] = {};
   sprintf(temp, "%s/%s", kFontsDir, kFontName);
   font_ = TTF_OpenFont(temp, kFontSize);
@@ -16,6 +20,12 @@ Render::Render(const GLWindow& window) {
   SDL_SetRenderDrawBlendMode(render_, SDL_BLENDMODE_BLEND);
 }
 
+Render::Render(SDL_Surface* surface) {
+  render_ = SDL_CreateSoftwareRenderer(surface);
+  assert(render_ != nullptr);
+  SDL_SetRenderDrawBlendMode(render_, SDL_BLENDMODE_BLEND);
+}
+
 SDL_Renderer* Render::GetRender() const {
   return render_;
 }
@@ -24,31 +34,79 @@ _TTF_Font* Render::GetFont() const {
   return font_;
 }
 
+void Render::PushTarget(Texture* target, const Point2D<int>& origin) {
+  assert(target->ownership_ == Texture::kOwned);
+  targets_.push_back({target->texture_, origin});
+}
+
+void Render::PopTarget() {
+  assert(!targets_.empty());
+  targets_.pop_back();
+}
+
+void Render::BeginFrame() {
+  assert(!is_recording_);
+  is_recording_ = true;
+}
+
+void Render::EndFrame() {
+  assert(is_recording_ && targets_.empty());
+  is_recording_ = false;
+  frame_.Submit(render_);
+}
+
+DisplayList* Render::GetFrameList() {
+  return is_recording_ && targets_.empty() ? &frame_ : nullptr;
+}
+
+void Render::SetScreenTarget() {
+  SDL_SetRenderTarget(render_, targets_.empty() ? nullptr : targets_.back().texture);
+}
+
+Point2D<int> Render::GetScreenOrigin() const {
+  return targets_.empty() ? Point2D<int>{0, 0} : targets_.back().origin;
+}
+
 void Render::DrawPoint(const Point2D<int>& coord,
                        const Color& color) {
-  SDL_SetRenderTarget(render_, nullptr);
+  if (DisplayList* list = GetFrameList()) {
+    list->AddPoint(coord, color);
+    return;
+  }
+  SetScreenTarget();
+  Point2D<int> point = coord - GetScreenOrigin();
   SDL_SetRenderDrawColor(render_, color.red, color.green, color.blue, color.alpha);
-  SDL_RenderDrawPoint(render_, coord.x, coord.y);
+  SDL_RenderDrawPoint(render_, point.x, point.y);
 }
 
 void Render::DrawText(const char* text_str,
                       const Point2D<int>& dest_coord,
                       const Color& color) {
-  SDL_SetRenderTarget(render_, nullptr);
+  assert(font_ != nullptr && "Text on a headless render");
   SDL_Surface* text = TTF_RenderText_Solid(font_, text_str, SDL_Color{color.red, color.green, color.blue, color.alpha});
   assert(text != nullptr);
 
   SDL_Texture* text_texture = SDL_CreateTextureFromSurface(render_, text);
   assert(text_texture != nullptr);
-  SDL_Rect dest = {dest_coord.x, dest_coord.y, text->w, text->h};
-  SDL_RenderCopy(render_, text_texture, nullptr, &dest);
-  
+  Point2D<int> corner = dest_coord - GetScreenOrigin();
+  if (DisplayList* list = GetFrameList()) {
+    // kept alive until the frame is submitted
+    list->AddOwnedCopy(text_texture, {corner, (uint)text->w, (uint)text->h});
+  } else {
+    SetScreenTarget();
+    SDL_Rect dest = {corner.x, corner.y, text->w, text->h};
+    SDL_RenderCopy(render_, text_texture, nullptr, &dest);
+    SDL_DestroyTexture(text_texture);
+  }
   SDL_FreeSurface(text);
-  SDL_DestroyTexture(text_texture);
 }
 
 void Render::SetBackgroundColor(const Color& color) {
-  SDL_SetRenderTarget(render_, nullptr);
+  if (DisplayList* list = GetFrameList()) {
+    list->AddClear(color);
+    return;
+  }
+  SetScreenTarget();
   SDL_SetRenderDrawColor(render_, color.red, color.green, color.blue, color.alpha);
   SDL_RenderClear(render_);
 }
@@ -58,6 +116,8 @@ SDL_Texture* Render::CreateTextureFromSurface(SDL_Surface* surface) {
 }
 
 Render::~Render() {
-  TTF_CloseFont(font_);
+  if (font_ != nullptr) {
+    TTF_CloseFont(font_);
+  }
   SDL_DestroyRenderer(render_);
 }
\ No newline at end of file
@@ -0,0 +1,485 @@
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unordered_map>
+#include <SDL2/SDL_image.h>
+#include "../include/main.h"
+#include "../include/Sandbox.h"
+#include "../include/Plugin.h"
+#include "../include/HeadlessWidgets.h"
+#include "../include/GUIConstants.h"
+
+// a filter that doesn't finish in this time is considered hung
+const int kFilterTimeoutMs = 10000;
+const size_t kMaxPluginPathLength = 512;
+
+namespace Sandbox {
+  struct Request {
+    uint width;
+    uint height;
+    uint filter_index;
+    char plugin_path[kMaxPluginPathLength];
+  };
+
+  enum Status {
+    kOk,
+    kNoPlugin,
+    kNoFilter,
+    kBadBuffer
+  };
+
+  // Child process
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+
+  // Plugin::Color is 0xAABBGGRR, pixels are RGBA8888 like the ones
+  // Plugin::Texture::ReadBuffer gives
+  static Plugin::Color ToPixel(Plugin::Color color) {
+    uint r = color & 0xFF;
+    uint g = (color >> 8) & 0xFF;
+    uint b = (color >> 16) & 0xFF;
+    uint a = (color >> 24) & 0xFF;
+    return (r << 24) | (g << 16) | (b << 8) | a;
+  }
+
+  static Plugin::Color BlendPixels(Plugin::Color dst, Plugin::Color src) {
+    uint src_alpha = src & 0xFF;
+    if (src_alpha == 0xFF) {
+      return src;
+    }
+    Plugin::Color result = 0;
+    for (uint shift = 8; shift < 32; shift += 8) {
+      uint s = (src >> shift) & 0xFF;
+      uint d = (dst >> shift) & 0xFF;
+      result |= ((s * src_alpha + d * (255 - src_alpha)) / 255) << shift;
+    }
+    uint dst_alpha = dst & 0xFF;
+    return result | (src_alpha + dst_alpha * (255 - src_alpha) / 255);
+  }
+
+  // ITexture over plain memory, works on the shared canvas in place
+  class CpuTexture : public Plugin::ITexture {
+   public:
+    CpuTexture(Plugin::Color* pixels, uint width, uint height)
+    : pixels_(pixels), width_(width), height_(height), is_owner_(false) {}
+
+    CpuTexture(uint width, uint height)
+    : pixels_(new Plugin::Color[width * height]()),
+      width_(width), height_(height), is_owner_(true) {}
+
+    ~CpuTexture() override {
+      if (is_owner_) {
+        delete[] pixels_;
+      }
+    }
+
+    uint GetWidth() override {return width_;}
+    uint GetHeight() override {return height_;}
+
+    Plugin::Buffer ReadBuffer() override {
+      return {pixels_, this};
+    }
+
+    void ReleaseBuffer(Plugin::Buffer buffer) override {
+      if (buffer.pixels != pixels_) {
+        delete[] buffer.pixels;
+      }
+    }
+
+    void LoadBuffer(Plugin::Buffer buffer) override {
+      if (buffer.pixels != pixels_) {
+        memcpy(pixels_, buffer.pixels, width_ * height_ * sizeof(Plugin::Color));
+      }
+    }
+
+    void Clear(Plugin::Color color) override {
+      Plugin::Color pixel = ToPixel(color);
+      for (uint i = 0; i < width_ * height_; ++i) {
+        pixels_[i] = pixel;
+      }
+    }
+
+    void Present() override {}
+
+    void DrawLine(const Plugin::Line& line) override {
+      Plugin::Color pixel = ToPixel(line.color);
+      float dx = (float)(line.x1 - line.x0);
+      float dy = (float)(line.y1 - line.y0);
+      uint len = (uint)sqrtf(dx * dx + dy * dy);
+      for (uint i = 0; i <= len; ++i) {
+        float t = len == 0 ? 0.0f : (float)i / (float)len;
+        FillCircle((int)((float)line.x0 + t * dx), (int)((float)line.y0 + t * dy),
+                   line.thickness, pixel);
+      }
+    }
+
+    void DrawCircle(const Plugin::Circle& circle) override {
+      FillCircle(circle.x, circle.y, circle.radius, ToPixel(circle.fill_color));
+    }
+
+    void DrawRect(const Plugin::Rect& rect) override {
+      Plugin::Color pixel = ToPixel(rect.fill_color);
+      for (int y = rect.y; y < rect.y + (int)rect.height; ++y) {
+        for (int x = rect.x; x < rect.x + (int)rect.width; ++x) {
+          PutPixel(x, y, pixel);
+        }
+      }
+    }
+
+    // scales the source to width x height like SDL_RenderCopy does
+    void CopyTexture(Plugin::ITexture* source, int x, int y, uint width, uint height) override {
+      CpuTexture* src = dynamic_cast<CpuTexture*>(source);
+      assert(src != nullptr);
+      for (uint j = 0; j < height; ++j) {
+        for (uint i = 0; i < width; ++i) {
+          uint src_x = i * src->width_ / width;
+          uint src_y = j * src->height_ / height;
+          PutPixel(x + (int)i, y + (int)j, src->pixels_[src_y * src->width_ + src_x]);
+        }
+      }
+    }
+
+    void CopyTexture(Plugin::ITexture* source, int x, int y) override {
+      CopyTexture(source, x, y, source->GetWidth(), source->GetHeight());
+    }
+
+   private:
+    Plugin::Color* pixels_;
+    uint width_;
+    uint height_;
+    bool is_owner_;
+
+    void PutPixel(int x, int y, Plugin::Color pixel) {
+      if (0 <= x && x < (int)width_ && 0 <= y && y < (int)height_) {
+        Plugin::Color& dst = pixels_[(uint)y * width_ + (uint)x];
+        dst = BlendPixels(dst, pixel);
+      }
+    }
+
+    void FillCircle(int center_x, int center_y, uint radius, Plugin::Color pixel) {
+      int r = (int)radius;
+      for (int y = -r; y <= r; ++y) {
+        for (int x = -r; x <= r; ++x) {
+          if (x * x + y * y <= r * r) {
+            PutPixel(center_x + x, center_y + y, pixel);
+          }
+        }
+      }
+    }
+  };
+
+  struct CpuTextureFactory : public Plugin::ITextureFactory {
+    Plugin::ITexture* CreateTexture(const char* filename) override {
+      std::string path = std::string(kSkinsDirName) + "/" + filename;
+      SDL_Surface* image = IMG_Load(path.c_str());
+      assert(image != nullptr);
+      SDL_Surface* converted = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA8888, 0);
+      assert(converted != nullptr);
+      SDL_FreeSurface(image);
+
+      auto texture = new CpuTexture((uint)converted->w, (uint)converted->h);
+      Plugin::Buffer buffer = texture->ReadBuffer();
+      for (int y = 0; y < converted->h; ++y) {
+        memcpy(buffer.pixels + y * converted->w, (char*)converted->pixels + y * converted->pitch,
+               converted->w * sizeof(Plugin::Color));
+      }
+      SDL_FreeSurface(converted);
+      return texture;
+    }
+
+    Plugin::ITexture* CreateTexture(uint width, uint height) override {
+      return new CpuTexture(width, height);
+    }
+  };
+
+  struct StubApi : public Plugin::IAPI {
+    Plugin::IWidgetFactory* GetWidgetFactory() override {return &widget_factory;}
+    Plugin::ITextureFactory* GetTextureFactory() override {return &texture_factory;}
+    Headless::WidgetFactory widget_factory;
+    CpuTextureFactory texture_factory;
+  };
+
+  static Plugin::IPlugin* LoadPlugin(const char* path, StubApi* api) {
+    void* handle = dlopen(path, RTLD_NOW);
+    if (handle == nullptr) {
+      return nullptr;
+    }
+    auto version = (Plugin::VersionFunction)dlsym(handle, "Version");
+    auto create = (Plugin::CreateFunction)dlsym(handle, "Create");
+    if (version == nullptr || create == nullptr || version() != Plugin::kVersion) {
+      dlclose(handle);
+      return nullptr;
+    }
+    // never unloaded, the child is restarted when plugins change
+    return create(api);
+  }
+
+  static Status ApplyRequest(const Request& request, int memfd, StubApi* api,
+                             std::unordered_map<std::string, Plugin::IPlugin*>* plugins) {
+    auto it = plugins->find(request.plugin_path);
+    if (it == plugins->end()) {
+      it = plugins->insert({request.plugin_path, LoadPlugin(request.plugin_path, api)}).first;
+    }
+    Plugin::IPlugin* plugin = it->second;
+    if (plugin == nullptr) {
+      return kNoPlugin;
+    }
+    Plugin::Filters filters = plugin->GetFilters();
+    if (request.filter_index >= filters.count) {
+      return kNoFilter;
+    }
+
+    size_t size = (size_t)request.width * request.height * sizeof(Plugin::Color);
+    void* pixels = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd, 0);
+    if (pixels == MAP_FAILED) {
+      return kBadBuffer;
+    }
+    CpuTexture canvas((Plugin::Color*)pixels, request.width, request.height);
+    filters.filters[request.filter_index]->Apply(&canvas);
+    munmap(pixels, size);
+    return kOk;
+  }
+
+  int RunChild(int socket_fd) {
+    StubApi api;
+    std::unordered_map<std::string, Plugin::IPlugin*> plugins;
+
+    while (true) {
+      Request request = {};
+      iovec data = {&request, sizeof(request)};
+      char control[CMSG_SPACE(sizeof(int))] = {};
+      msghdr message = {};
+      message.msg_iov = &data;
+      message.msg_iovlen = 1;
+      message.msg_control = control;
+      message.msg_controllen = sizeof(control);
+
+      ssize_t received = recvmsg(socket_fd, &message, 0);
+      if (received <= 0) {
+        // the app has quit
+        return 0;
+      }
+      cmsghdr* header = CMSG_FIRSTHDR(&message);
+      if (received != sizeof(request) || header == nullptr || header->cmsg_type != SCM_RIGHTS) {
+        return 1;
+      }
+      int memfd = -1;
+      memcpy(&memfd, CMSG_DATA(header), sizeof(memfd));
+      request.plugin_path[kMaxPluginPathLength - 1] = '\0';
+
+      int status = ApplyRequest(request, memfd, &api, &plugins);
+      close(memfd);
+      if (send(socket_fd, &status, sizeof(status), MSG_NOSIGNAL) != sizeof(status)) {
+        return 1;
+      }
+    }
+  }
+
+  // Host
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  Host::Host()
+  : is_enabled_(false), child_(-1), socket_(-1), memfd_(-1),
+    pixels_(nullptr), mapped_size_(0) {}
+
+  Host::~Host() {
+    if (child_ > 0) {
+      // the child exits on EOF
+      close(socket_);
+      waitpid(child_, nullptr, 0);
+    }
+    if (pixels_ != nullptr) {
+      munmap(pixels_, mapped_size_);
+    }
+    if (memfd_ >= 0) {
+      close(memfd_);
+    }
+  }
+
+  void Host::Enable() {
+    is_enabled_ = true;
+  }
+
+  bool Host::IsEnabled() const {
+    return is_enabled_;
+  }
+
+  bool Host::Spawn() {
+    int sockets[2] = {};
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) < 0) {
+      return false;
+    }
+    // everything the child needs is prepared before fork: the app has
+    // threads, so only async-signal-safe calls are allowed until exec
+    char fd_arg[16] = {};
+    snprintf(fd_arg, sizeof(fd_arg), "%d", sockets[1]);
+
+    pid_t pid = fork();
+    if (pid < 0) {
+      close(sockets[0]);
+      close(sockets[1]);
+      return false;
+    }
+    if (pid == 0) {
+      fcntl(sockets[1], F_SETFD, 0);
+      execl("/proc/self/exe", "out", kChildFlag, fd_arg, (char*)nullptr);
+      _exit(127);
+    }
+
+    close(sockets[1]);
+    socket_ = sockets[0];
+    child_ = pid;
+    return true;
+  }
+
+  void Host::Kill() {
+    if (child_ > 0) {
+      kill(child_, SIGKILL);
+      waitpid(child_, nullptr, 0);
+      close(socket_);
+    }
+    child_ = -1;
+    socket_ = -1;
+  }
+
+  void Host::Restart() {
+    Kill();
+  }
+
+  Plugin::Color* Host::GetPixels(uint width, uint height) {
+    size_t size = (size_t)width * height * sizeof(Plugin::Color);
+    if (size <= mapped_size_) {
+      return pixels_;
+    }
+    if (memfd_ < 0) {
+      memfd_ = memfd_create("canvas", MFD_CLOEXEC);
+      if (memfd_ < 0) {
+        printf("Warning: can't create the sandbox buffer: %s\n", strerror(errno));
+        return nullptr;
+      }
+    }
+    if (pixels_ != nullptr) {
+      munmap(pixels_, mapped_size_);
+      pixels_ = nullptr;
+      mapped_size_ = 0;
+    }
+    if (ftruncate(memfd_, size) != 0) {
+      printf("Warning: can't resize the sandbox buffer: %s\n", strerror(errno));
+      return nullptr;
+    }
+    void* pixels = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, memfd_, 0);
+    if (pixels == MAP_FAILED) {
+      printf("Warning: can't map the sandbox buffer: %s\n", strerror(errno));
+      return nullptr;
+    }
+    pixels_ = (Plugin::Color*)pixels;
+    mapped_size_ = size;
+    return pixels_;
+  }
+
+  bool Host::SendRequest(const std::string& plugin_path, uint filter_index,
+                         uint width, uint height) {
+    Request request = {width, height, filter_index, {}};
+    assert(plugin_path.size() < kMaxPluginPathLength);
+    strcpy(request.plugin_path, plugin_path.c_str());
+
+    iovec data = {&request, sizeof(request)};
+    char control[CMSG_SPACE(sizeof(int))] = {};
+    msghdr message = {};
+    message.msg_iov = &data;
+    message.msg_iovlen = 1;
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    cmsghdr* header = CMSG_FIRSTHDR(&message);
+    header->cmsg_level = SOL_SOCKET;
+    header->cmsg_type = SCM_RIGHTS;
+    header->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(header), &memfd_, sizeof(memfd_));
+
+    return sendmsg(socket_, &message, MSG_NOSIGNAL) == sizeof(request);
+  }
+
+  bool Host::Apply(const std::string& plugin_path, uint filter_index,
+                   uint width, uint height) {
+    assert(is_enabled_);
+    assert(mapped_size_ >= (size_t)width * height * sizeof(Plugin::Color));
+    // the child could have died since the last call, it's restarted once
+    if ((child_ < 0 || !SendRequest(plugin_path, filter_index, width, height)) &&
+        (Kill(), !Spawn() || !SendRequest(plugin_path, filter_index, width, height))) {
+      printf("Warning: can't start the filters sandbox\n");
+      Kill();
+      return false;
+    }
+
+    pollfd poll_fd = {socket_, POLLIN, 0};
+    if (poll(&poll_fd, 1, kFilterTimeoutMs) <= 0) {
+      printf("Warning: filter from %s didn't finish in %d ms and was killed\n",
+             plugin_path.c_str(), kFilterTimeoutMs);
+      Kill();
+      return false;
+    }
+    int status = kOk;
+    if (recv(socket_, &status, sizeof(status), 0) != sizeof(status)) {
+      printf("Warning: filter from %s crashed\n", plugin_path.c_str());
+      Kill();
+      return false;
+    }
+    if (status != kOk) {
+      printf("Warning: sandbox can't apply filter %u from %s (error %d)\n",
+             filter_index, plugin_path.c_str(), status);
+      return false;
+    }
+    return true;
+  }
+
+  // Filter
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  // -----------------------------------------------------
+  Filter::Filter(Plugin::IFilter* filter, const std::string& plugin_path,
+                 uint filter_index)
+  : filter_(filter), plugin_path_(plugin_path), filter_index_(filter_index) {}
+
+  void Filter::Apply(Plugin::ITexture* canvas) {
+    Plugin::Texture* texture = dynamic_cast<Plugin::Texture*>(canvas);
+    assert(texture != nullptr);
+    uint width = texture->GetWidth();
+    uint height = texture->GetHeight();
+
+    Host& host = Host::GetInstance();
+    Plugin::Color* pixels = host.GetPixels(width, height);
+    if (pixels == nullptr) {
+      return;
+    }
+    texture->ReadPixels(pixels);
+    if (host.Apply(plugin_path_, filter_index_, width, height)) {
+      texture->WritePixels(pixels);
+    }
+  }
+
+  const char* Filter::GetName() const {
+    return filter_->GetName();
+  }
+
+  Plugin::IPreferencesPanel* Filter::GetPreferencesPanel() const {
+    // the panel would change the instance in this process, not the one
+    // applying the filter in the child
+    return nullptr;
+  }
+}
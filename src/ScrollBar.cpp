@@ -11,14 +11,8 @@ namespace Listener {
     }
   }
 
-  Scroll::Scroll(Functor::Scroll* scroll_func,
-                 Widget::Scroll* widget_scroll,
-                 ScrollType scroll_type,
-                 int bound0,
-                 int bound1)
-  : scroll_func_(scroll_func), widget_scroll_(widget_scroll),
-    scroll_type_(scroll_type),
-    bound0_(bound0), bound1_(bound1) {}
+  Scroll::Scroll(Widget::Scroll* widget_scroll)
+  : widget_scroll_(widget_scroll) {}
 
   void Scroll::ProcessSystemEvent(const SystemEvent& event) {
     switch (event.type) {
@@ -33,16 +27,20 @@ namespace Listener {
         int y_diff = (int)info.new_mouse_pos.y - (int)info.old_mouse_pos.y;
 
         Rectangle pos = widget_scroll_->GetPosition();
-        if (scroll_type_ == ScrollType::kHorizontal) {
-          pos.corner.x = Max(bound0_, Min(pos.corner.x + x_diff, bound1_ - (int)pos.width));
+        Functor::Scroll* scroll_func = widget_scroll_->scroll_func_;
+        int bound0 = widget_scroll_->bound0_;
+        int bound1 = widget_scroll_->bound1_;
+        ScrollType scroll_type = widget_scroll_->scroll_type_;
+        if (scroll_type == ScrollType::kHorizontal) {
+          pos.corner.x = Max(bound0, Min(pos.corner.x + x_diff, bound1 - (int)pos.width));
           widget_scroll_->SetPosition(pos);
-          scroll_func_->SetScrollPos((float)(pos.corner.x - bound0_) / (float)(bound1_ - bound0_ - pos.width));
-          FunctorQueue::GetInstance().Push(scroll_func_);
-        } else if (scroll_type_ == ScrollType::kVertical) {
-          pos.corner.y = Max(bound0_, Min(pos.corner.y + y_diff, bound1_ - (int)pos.height));
+          scroll_func->SetScrollPos((float)(pos.corner.x - bound0) / (float)(bound1 - bound0 - pos.width));
+          FunctorQueue::GetInstance().PushCoalesced(scroll_func);
+        } else if (scroll_type == ScrollType::kVertical) {
+          pos.corner.y = Max(bound0, Min(pos.corner.y + y_diff, bound1 - (int)pos.height));
           widget_scroll_->SetPosition(pos);
-          scroll_func_->SetScrollPos((float)(pos.corner.y - bound0_) / (float)(bound1_ - bound0_ - pos.height));
-          FunctorQueue::GetInstance().Push(scroll_func_);
+          scroll_func->SetScrollPos((float)(pos.corner.y - bound0) / (float)(bound1 - bound0 - pos.height));
+          FunctorQueue::GetInstance().PushCoalesced(scroll_func);
         }
 
         break;
@@ -65,7 +63,7 @@ namespace Widget {
     scroll_type_(scroll_type),
     bound0_(bound0), bound1_(bound1),
     scroll_func_(scroll_func), draw_funcs_(draw_funcs),
-    hover_listener_(nullptr), scroll_listener_(nullptr)
+    hover_listener_(this), scroll_listener_(this)
   {
     assert(bound0 <= bound1);
     if (scroll_func_ != nullptr) {
@@ -74,10 +72,10 @@ namespace Widget {
   }
 
   Scroll::~Scroll() {
-    if (hover_listener_ != nullptr) {
+    if (hover_listener_.IsListening()) {
       StopHovering();
     }
-    if (scroll_listener_ != nullptr) {
+    if (scroll_listener_.IsListening()) {
       FinishScroll();
     }
   }
@@ -91,38 +89,32 @@ namespace Widget {
   }
 
   void Scroll::StartHovering() {
-    hover_listener_ = new Listener::ScrollHover(this);
-    main_window_->AddListener(SystemEvent::kMouseMotion, hover_listener_);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &hover_listener_);
     if (draw_funcs_.draw_func_hover != nullptr) {
-      draw_func_ = draw_funcs_.draw_func_hover;
+      SetDrawFunc(draw_funcs_.draw_func_hover);
     }
   }
 
   void Scroll::StopHovering() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, hover_listener_);
-    delete hover_listener_;
-    hover_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &hover_listener_);
     if (draw_func_ == draw_funcs_.draw_func_hover) {
-      draw_func_ = draw_funcs_.draw_func_main;
+      SetDrawFunc(draw_funcs_.draw_func_main);
     }
   }
 
   void Scroll::StartScroll() {
-    scroll_listener_ = new Listener::Scroll(scroll_func_, this, scroll_type_, bound0_, bound1_);
-    main_window_->AddListener(SystemEvent::kMouseMotion, scroll_listener_);
-    main_window_->AddListener(SystemEvent::kMouseButtonUp, scroll_listener_);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &scroll_listener_);
+    main_window_->AddListener(SystemEvent::kMouseButtonUp, &scroll_listener_);
     if (draw_funcs_.draw_func_click != nullptr) {
-      draw_func_ = draw_funcs_.draw_func_click;
+      SetDrawFunc(draw_funcs_.draw_func_click);
     }
   }
 
   void Scroll::FinishScroll() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, scroll_listener_);
-    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, scroll_listener_);
-    delete scroll_listener_;
-    scroll_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &scroll_listener_);
+    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, &scroll_listener_);
     if (draw_func_ == draw_funcs_.draw_func_click) {
-      draw_func_ = draw_funcs_.draw_func_main;
+      SetDrawFunc(draw_funcs_.draw_func_main);
     }
   }
 
@@ -134,8 +126,8 @@ namespace Widget {
       }
 
       case SystemEvent::kMouseMotion: {
-        if (hover_listener_ == nullptr) {
-          if (scroll_listener_ == nullptr) {
+        if (!hover_listener_.IsListening()) {
+          if (!scroll_listener_.IsListening()) {
             StartHovering();
           }
         } // else it's already processed by listener
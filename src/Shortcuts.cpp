@@ -0,0 +1,25 @@
+#include <SDL2/SDL.h>
+#include "../include/Shortcuts.h"
+
+static_assert(ShortcutTable::kScancodesCount == SDL_NUM_SCANCODES,
+              "every scancode has a row");
+
+ShortcutTable::ShortcutTable()
+: table_() {}
+
+void ShortcutTable::Bind(int scancode, uint modifiers, Functor::Abstract* func) {
+  assert(0 <= scancode && scancode < (int)kScancodesCount);
+  assert(modifiers < KeyboardKeyClickInfo::kModifiersCount);
+  table_[scancode][modifiers] = func;
+}
+
+void ShortcutTable::Unbind(int scancode, uint modifiers) {
+  Bind(scancode, modifiers, nullptr);
+}
+
+Functor::Abstract* ShortcutTable::Find(const KeyboardKeyClickInfo& key) const {
+  if (key.scancode < 0 || key.scancode >= (int)kScancodesCount) {
+    return nullptr;
+  }
+  return table_[key.scancode][key.modifiers];
+}
@@ -1,6 +1,7 @@
 #include <cassert>
 #include <cstdio>
 #include <stack>
+#include <thread>
 #include <cstdlib>
 #include "../include/StackTrace.h"
 
@@ -54,7 +55,7 @@ class StackTrace {
   }
 
   StackTrace(std::initializer_list<int> signums, size_t max_size)
-  : segv_stack{}, max_size_(max_size)
+  : segv_stack{}, max_size_(max_size), owner_(std::this_thread::get_id())
   {
     segv_stack.ss_size = 4096;
     segv_stack.ss_sp = valloc(segv_stack.ss_size);
@@ -75,10 +76,16 @@ class StackTrace {
   }
 
   void Push(const Info& info) {
+    if (std::this_thread::get_id() != owner_) {
+      return;
+    }
     stack_.push(info);
   }
 
   void Pop() {
+    if (std::this_thread::get_id() != owner_) {
+      return;
+    }
     if (stack_.empty()) {
       printf("Pop from empty StackTrace!!!\n");
       return;
@@ -90,6 +97,9 @@ class StackTrace {
   std::stack<Info> stack_;
   stack_t segv_stack;
   size_t max_size_;
+  // only the thread that created the trace is traced, the stack isn't
+  // shared between threads
+  std::thread::id owner_;
 };
 
 StackTrace* tracer = nullptr;
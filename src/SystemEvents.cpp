@@ -1,12 +1,22 @@
 #include <SDL2/SDL.h>
 #include "../include/SystemEvents.h"
 
-bool IsSomeEventInQueue(SystemEvent* event) {
-  SDL_Event sdl_event;
-  if (!SDL_PollEvent(&sdl_event)) {
-    return false;
+static KeyboardKeyClickInfo ConvertKey(const SDL_KeyboardEvent& key) {
+  uint modifiers = 0;
+  if (key.keysym.mod & KMOD_SHIFT) {
+    modifiers |= KeyboardKeyClickInfo::kShift;
   }
+  if (key.keysym.mod & KMOD_CTRL) {
+    modifiers |= KeyboardKeyClickInfo::kCtrl;
+  }
+  if (key.keysym.mod & KMOD_ALT) {
+    modifiers |= KeyboardKeyClickInfo::kAlt;
+  }
+  return {key.keysym.scancode, modifiers, key.repeat != 0};
+}
 
+// false for events the app doesn't handle
+static bool ConvertEvent(const SDL_Event& sdl_event, SystemEvent* event) {
   switch (sdl_event.type) {
     case SDL_QUIT: {
       event->type = SystemEvent::kQuit;
@@ -15,13 +25,13 @@ bool IsSomeEventInQueue(SystemEvent* event) {
 
     case SDL_KEYDOWN: {
       event->type = SystemEvent::kKeyboardKeyDown;
-      event->info.keyboard_key_click = {sdl_event.key.keysym.scancode};
+      event->info.keyboard_key_click = ConvertKey(sdl_event.key);
       break;
     }
 
     case SDL_KEYUP: {
       event->type = SystemEvent::kKeyboardKeyUp;
-      event->info.keyboard_key_click = {sdl_event.key.keysym.scancode};
+      event->info.keyboard_key_click = ConvertKey(sdl_event.key);
       break;
     }
 
@@ -61,7 +71,8 @@ bool IsSomeEventInQueue(SystemEvent* event) {
       assert(info.x >= 0);
       assert(info.y >= 0);
       event->info.mouse_motion = { {(uint)info.x, (uint)info.y},
-                                   {(uint)Max(0, info.x + info.xrel), (uint)Max(0, info.y + info.yrel)} };
+                                   {(uint)Max(0, info.x + info.xrel), (uint)Max(0, info.y + info.yrel)},
+                                   info.state != 0 };
       break;
     }
 
@@ -84,4 +95,135 @@ bool IsSomeEventInQueue(SystemEvent* event) {
   }
 
   return true;
+}
+
+namespace EventFilter {
+  void CoalesceMotion::Apply(SystemEvent* events, size_t* count) {
+    size_t kept = 0;
+    for (size_t i = 0; i < *count; ++i) {
+      const SystemEvent& event = events[i];
+      if (kept != 0 && event.type == SystemEvent::kMouseMotion &&
+          !event.info.mouse_motion.is_button_pressed) {
+        SystemEvent& prev = events[kept - 1];
+        if (prev.type == SystemEvent::kMouseMotion && !prev.info.mouse_motion.is_button_pressed) {
+          prev.info.mouse_motion.new_mouse_pos = event.info.mouse_motion.new_mouse_pos;
+          prev.time_us = event.time_us;
+          continue;
+        }
+      }
+      events[kept++] = event;
+    }
+    *count = kept;
+  }
+
+  void DropStaleResizes::Apply(SystemEvent* events, size_t* count) {
+    size_t kept = 0;
+    for (size_t i = 0; i < *count; ++i) {
+      const SystemEvent& event = events[i];
+      bool is_stale = false;
+      if (event.type == SystemEvent::kWindowResize) {
+        for (size_t j = i + 1; j < *count && !is_stale; ++j) {
+          is_stale = events[j].type == SystemEvent::kWindowResize &&
+                     events[j].info.window_resize.window_id == event.info.window_resize.window_id;
+        }
+      }
+      if (!is_stale) {
+        events[kept++] = event;
+      }
+    }
+    *count = kept;
+  }
+
+  Record::Record(FILE* file)
+  : file_(file), frame_(0) {}
+
+  Record::~Record() {
+    fclose(file_);
+  }
+
+  void Record::Apply(SystemEvent* events, size_t* count) {
+    for (size_t i = 0; i < *count; ++i) {
+      fwrite(&frame_, sizeof(frame_), 1, file_);
+      fwrite(&events[i], sizeof(SystemEvent), 1, file_);
+    }
+    ++frame_;
+  }
+}
+
+static_assert((EventPump::kInputCapacity & (EventPump::kInputCapacity - 1)) == 0,
+              "positions are mapped to the ring with a mask");
+
+EventPump::EventPump()
+: events_{}, count_(0), record_(nullptr), input_{},
+  input_push_pos_(0), input_pop_pos_(0), counter_frequency_(0) {
+  filters_.push_back(&coalesce_motion_);
+  filters_.push_back(&drop_stale_resizes_);
+}
+
+EventPump::~EventPump() {
+  delete record_;
+}
+
+void EventPump::Start() {
+  counter_frequency_ = SDL_GetPerformanceFrequency();
+  SDL_AddEventWatch(&Watch, this);
+}
+
+int EventPump::Watch(void* pump_ptr, SDL_Event* sdl_event) {
+  EventPump* pump = static_cast<EventPump*>(pump_ptr);
+  uint64_t counter = SDL_GetPerformanceCounter();
+  size_t push_pos = pump->input_push_pos_.load(std::memory_order_relaxed);
+  if (push_pos - pump->input_pop_pos_.load(std::memory_order_acquire) == kInputCapacity) {
+    // the UI thread is that far behind, newer input is dropped
+    return 0;
+  }
+  SystemEvent* event = &pump->input_[push_pos & (kInputCapacity - 1)];
+  if (ConvertEvent(*sdl_event, event)) {
+    // split to keep counter * 10^6 from overflowing
+    uint64_t frequency = pump->counter_frequency_;
+    event->time_us = counter / frequency * 1000000 + counter % frequency * 1000000 / frequency;
+    pump->input_push_pos_.store(push_pos + 1, std::memory_order_release);
+  }
+  return 0;
+}
+
+void EventPump::PumpInput() {
+  SDL_PumpEvents();
+}
+
+size_t EventPump::Collect() {
+  SDL_PumpEvents();
+  // the watch has taken what's needed, SDL's copies would only pile up
+  SDL_FlushEvents(SDL_FIRSTEVENT, SDL_LASTEVENT);
+  count_ = 0;
+  size_t pop_pos = input_pop_pos_.load(std::memory_order_relaxed);
+  size_t push_pos = input_push_pos_.load(std::memory_order_acquire);
+  while (pop_pos != push_pos && count_ < kCapacity) {
+    events_[count_++] = input_[pop_pos++ & (kInputCapacity - 1)];
+  }
+  input_pop_pos_.store(pop_pos, std::memory_order_release);
+  for (auto filter : filters_) {
+    filter->Apply(events_, &count_);
+  }
+  return count_;
+}
+
+const SystemEvent* EventPump::GetEvents() const {
+  return events_;
+}
+
+void EventPump::AddFilter(EventFilter::Abstract* filter) {
+  filters_.push_back(filter);
+}
+
+void EventPump::StartRecording(const char* path) {
+  assert(record_ == nullptr);
+  FILE* file = fopen(path, "wb");
+  if (file == nullptr) {
+    printf("Warning: can't open %s, events aren't recorded\n", path);
+    return;
+  }
+  record_ = new EventFilter::Record(file);
+  // recorded before the other filters touch the batch
+  filters_.insert(filters_.begin(), record_);
 }
\ No newline at end of file
@@ -1,41 +1,54 @@
 #include <SDL2/SDL_image.h>
 #include <SDL2/SDL_ttf.h>
-#include <unistd.h>
+#include <string>
 #include "../include/Render.h"
 #include "../include/Texture.h"
+#include "../include/TextureCache.h"
+#include "../include/Atlas.h"
 #include "../include/GUIConstants.h"
+#include "../include/PngExport.h"
 
-bool IsFileExists(const char* name) {
-	return access(name, F_OK) == 0;
+Texture::Texture(const char* image_name, Render* render)
+: render_(render), ownership_(kShared), origin_(0, 0),
+  atlas_(nullptr), atlas_image_(0)
+{
+	std::string image_path = std::string(kSkinsDirName) + "/" + image_name;
+	const TextureCache::Entry& entry = TextureCache::GetInstance().Acquire(image_path.c_str(), render);
+	texture_ = entry.texture;
+	width_  = entry.width;
+	height_ = entry.height;
 }
 
-Texture::Texture(const char* image_name, Render* render)
-: render_(render)
+Texture::Texture(SDL_Texture* texture, const Rectangle& region, Render* render)
+: texture_(texture), render_(render), ownership_(kBorrowed),
+  origin_(region.corner), width_(region.width), height_(region.height),
+  atlas_(nullptr), atlas_image_(0)
 {
-	static char image_path[100] = {};
-	sprintf(image_path, "%s/%s", kSkinsDirName, image_name);
+	assert(texture_ != nullptr);
+}
 
-	if (!IsFileExists(image_path)) {
-		printf("ERROR: can't find file %s\nAborted\n", image_path);
-		exit(255);
-	}
-	SDL_Surface* image_surface = IMG_Load(image_path);
-	assert(image_surface != NULL);
-	texture_ = render->CreateTextureFromSurface(image_surface);
-	assert(texture_ != NULL);
-	SDL_FreeSurface(image_surface);
+Texture::Texture(Atlas* atlas, size_t image_index, Render* render)
+: texture_(nullptr), render_(render), ownership_(kBorrowed),
+  origin_(0, 0), width_(0), height_(0),
+  atlas_(atlas), atlas_image_(image_index)
+{
+	assert(atlas_ != nullptr);
+}
 
-	int w = 0;
-	int h = 0;
-	SDL_QueryTexture(texture_, NULL, NULL, &w, &h);
-	assert(w >= 0);
-	assert(h >= 0);
-	width_  = (uint)w;
-	height_ = (uint)h;
+void Texture::Resolve() const {
+	if (texture_ == nullptr) {
+		assert(atlas_ != nullptr);
+		Rectangle region = {};
+		texture_ = atlas_->GetImagePage(atlas_image_, &region);
+		origin_ = region.corner;
+		width_  = region.width;
+		height_ = region.height;
+	}
 }
 
 Texture::Texture(const char* text, Render* render, const Color& color)
-: render_(render)
+: render_(render), ownership_(kOwned), origin_(0, 0),
+  atlas_(nullptr), atlas_image_(0)
 {
 	SDL_Surface* text_surface = TTF_RenderText_Solid(render_->GetFont(), text, SDL_Color{color.red, color.green, color.blue, color.alpha});
 	assert(text_surface != nullptr);
@@ -65,7 +78,8 @@ Texture::Texture(const char* text, Render* render, const Color& color)
 }
 
 Texture::Texture(uint width, uint height, Render* render, const Color& color)
-: render_(render), width_(width), height_(height)
+: render_(render), ownership_(kOwned), origin_(0, 0), width_(width), height_(height),
+  atlas_(nullptr), atlas_image_(0)
 {
 	texture_ = SDL_CreateTexture(render->render_,
 		                           SDL_PIXELFORMAT_RGBA8888,
@@ -85,19 +99,24 @@ Texture::Texture(uint width, uint height, Render* render, const Color& color)
 }
 
 Texture::Texture(const Texture& texture)
-: Texture(texture.width_, texture.height_, texture.render_)
+: Texture(texture.GetWidth(), texture.GetHeight(), texture.render_)
 {
 	CopyTexture(texture, nullptr);
 }
 
 Texture::~Texture() {
 	$;
-	SDL_DestroyTexture(texture_);
+	if (ownership_ == kShared) {
+		TextureCache::GetInstance().Release(texture_);
+	} else if (ownership_ == kOwned) {
+		SDL_DestroyTexture(texture_);
+	}
 	texture_ = NULL;
 	$$;
 }
 
 void Texture::CopyTexture(const Texture& texture, const Rectangle* dest) {
+	texture.Resolve();
 	SDL_SetRenderTarget(render_->render_, texture_);
 	SDL_Rect dest_rect = {};
 	SDL_Rect* dest_ptr = &dest_rect;
@@ -107,39 +126,105 @@ void Texture::CopyTexture(const Texture& texture, const Rectangle* dest) {
 	} else {
 		dest_ptr = nullptr;
 	}
-	SDL_RenderCopy(render_->render_, texture.texture_, nullptr, dest_ptr);
+	SDL_Rect src_rect = { texture.origin_.x, texture.origin_.y,
+	                      (int)texture.width_, (int)texture.height_ };
+	SDL_RenderCopy(render_->render_, texture.texture_, &src_rect, dest_ptr);
 }
 
 void Texture::Draw(const Rectangle* src,
                    const Rectangle* dest) {
-	SDL_Rect src_rect = {};
-	SDL_Rect* src_ptr = &src_rect;
+	Resolve();
+	SDL_Rect src_rect = { origin_.x, origin_.y, (int)width_, (int)height_ };
 	if (src != nullptr) {
-		src_rect = { src->corner.x, src->corner.y,
+		src_rect = { origin_.x + src->corner.x, origin_.y + src->corner.y,
 			           (int)src->width, (int)src->height };
-	} else {
-		src_ptr = nullptr;
+	}
+	assert(texture_ != nullptr);
+	if (DisplayList* list = render_->GetFrameList()) {
+		Rectangle dest_rectangle = {{0, 0}, 0, 0};
+		if (dest != nullptr) {
+			dest_rectangle = *dest;
+		} else {
+			int width = 0;
+			int height = 0;
+			SDL_GetRendererOutputSize(render_->render_, &width, &height);
+			dest_rectangle = {{0, 0}, (uint)width, (uint)height};
+		}
+		list->AddQuad(texture_, {{src_rect.x, src_rect.y}, (uint)src_rect.w, (uint)src_rect.h}, dest_rectangle);
+		return;
 	}
 	SDL_Rect dest_rect = {};
 	SDL_Rect* dest_ptr = &dest_rect;
 	if (dest != nullptr) {
-		dest_rect = { dest->corner.x, dest->corner.y,
+		Point2D<int> corner = dest->corner - render_->GetScreenOrigin();
+		dest_rect = { corner.x, corner.y,
 			            (int)dest->width, (int)dest->height };
 	} else {
 		dest_ptr = nullptr;
 	}
-	assert(texture_ != nullptr);
-	SDL_SetRenderTarget(render_->render_, nullptr);
-	SDL_RenderCopy(render_->render_, texture_, src_ptr, dest_ptr);
+	render_->SetScreenTarget();
+	SDL_RenderCopy(render_->render_, texture_, &src_rect, dest_ptr);
 }
 
 void Texture::DrawWithNoScale(const Rectangle* dest,
 	                            const Point2D<int>& src) {
+	Resolve();
 	Rectangle srcc = { src, Min(width_, dest->width),
 	                   Min(height_, dest->height) };
 	this->Draw(&srcc, dest);
 }
 
+void Texture::DrawQuads(const std::vector<TexturedQuad>& quads) {
+	if (quads.empty()) {
+		return;
+	}
+	// batched with the other draws of the frame
+	if (DisplayList* list = quads[0].texture->render_->GetFrameList()) {
+		for (const TexturedQuad& quad : quads) {
+			quad.texture->Resolve();
+			Rectangle src = {quad.texture->origin_ + quad.src.corner, quad.src.width, quad.src.height};
+			list->AddQuad(quad.texture->texture_, src, quad.dst);
+		}
+		return;
+	}
+
+	// reused between calls, drawing only happens on the UI thread
+	static std::vector<SDL_Vertex> vertices;
+	static std::vector<int> indices;
+
+	size_t begin = 0;
+	while (begin < quads.size()) {
+		const Texture* texture = quads[begin].texture;
+		texture->Resolve();
+		int page_width = 0;
+		int page_height = 0;
+		SDL_QueryTexture(texture->texture_, NULL, NULL, &page_width, &page_height);
+
+		Point2D<int> screen_origin = texture->render_->GetScreenOrigin();
+		vertices.clear();
+		indices.clear();
+		size_t end = begin;
+		for (; end < quads.size(); ++end) {
+			const TexturedQuad& quad = quads[end];
+			quad.texture->Resolve();
+			if (quad.texture->texture_ != texture->texture_) {
+				break;
+			}
+			Rectangle src = {quad.texture->origin_ + quad.src.corner, quad.src.width, quad.src.height};
+			Rectangle dst = quad.dst;
+			dst.corner -= screen_origin;
+			DisplayList::AppendQuad(&vertices, &indices, (int)vertices.size(), src, dst,
+			                        page_width, page_height);
+		}
+
+		texture->render_->SetScreenTarget();
+		SDL_RenderGeometry(texture->render_->render_, texture->texture_,
+		                   vertices.data(), (int)vertices.size(),
+		                   indices.data(), (int)indices.size());
+		begin = end;
+	}
+}
+
 void Texture::DrawLine(const Point2D<int>& coord1,
                        const Point2D<int>& coord2,
                        const Color& color) {
@@ -217,6 +302,12 @@ void Texture::DrawText(const char* text_str,
   SDL_DestroyTexture(text_texture);
 }
 
+void Texture::Clear() {
+	SDL_SetRenderTarget(render_->render_, texture_);
+	SDL_SetRenderDrawColor(render_->render_, 0, 0, 0, 0);
+	SDL_RenderClear(render_->render_);
+}
+
 void Texture::SetBackgroundColor(const Color& color) {
 	SDL_SetRenderTarget(render_->render_, texture_);
   SDL_SetRenderDrawColor(render_->render_, color.red, color.green, color.blue, color.alpha);
@@ -224,21 +315,26 @@ void Texture::SetBackgroundColor(const Color& color) {
 }
 
 uint Texture::GetWidth() const {
+	Resolve();
 	return width_;
 }
 
 uint Texture::GetHeight() const {
+	Resolve();
 	return height_;
 }
 
-void Texture::SaveToPNG(const char* file_name) {
-  int width, height;
-  SDL_QueryTexture(texture_, NULL, NULL, &width, &height);
-  SDL_Surface* surface = SDL_CreateRGBSurface(0, width, height, 32, 0xff000000, 0xff0000, 0xff00, 0xff);
+bool Texture::SaveToPNG(const char* file_name) {
+  Resolve();
+  std::vector<uint> pixels((size_t)width_ * height_);
+  SDL_Rect region = {origin_.x, origin_.y, (int)width_, (int)height_};
   SDL_SetRenderTarget(render_->render_, texture_);
-  SDL_RenderReadPixels(render_->render_, NULL, surface->format->format, surface->pixels, surface->pitch);
-  char file_name_png[100] = {};
-  sprintf(file_name_png, "%s.png", file_name);
-  IMG_SavePNG(surface, file_name_png);
-  SDL_FreeSurface(surface);
+  assert(!SDL_RenderReadPixels(render_->render_, &region, SDL_PIXELFORMAT_RGBA8888,
+                               pixels.data(), width_ * sizeof(uint)));
+  std::string file_name_png = std::string(file_name) + ".png";
+  if (!Png::Write(file_name_png.c_str(), pixels.data(), width_, height_)) {
+    printf("Warning: can't save %s\n", file_name_png.c_str());
+    return false;
+  }
+  return true;
 }
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include <SDL2/SDL_image.h>
+#include <unistd.h>
+#include "../include/Render.h"
+#include "../include/TextureCache.h"
+
+static bool IsFileExists(const char* name) {
+	return access(name, F_OK) == 0;
+}
+
+const TextureCache::Entry& TextureCache::Acquire(const char* image_path,
+                                                 Render* render) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = entries_.find(Key{image_path, render});
+	if (it != entries_.end()) {
+		++hits_;
+		++it->second.ref_count;
+		return it->second;
+	}
+	++misses_;
+
+	if (!IsFileExists(image_path)) {
+		printf("ERROR: can't find file %s\nAborted\n", image_path);
+		exit(255);
+	}
+	SDL_Surface* image_surface = IMG_Load(image_path);
+	assert(image_surface != NULL);
+	SDL_Texture* texture = render->CreateTextureFromSurface(image_surface);
+	assert(texture != NULL);
+	SDL_FreeSurface(image_surface);
+
+	int w = 0;
+	int h = 0;
+	SDL_QueryTexture(texture, NULL, NULL, &w, &h);
+	assert(w >= 0);
+	assert(h >= 0);
+
+	Key key = {image_path, render};
+	Entry& entry = entries_[key];
+	entry = {texture, (uint)w, (uint)h, 1};
+	keys_[texture] = key;
+	return entry;
+}
+
+void TextureCache::Release(SDL_Texture* texture) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto key_it = keys_.find(texture);
+	assert(key_it != keys_.end() && "Release of a texture not owned by cache");
+	auto it = entries_.find(key_it->second);
+	assert(it != entries_.end());
+	assert(it->second.ref_count > 0);
+	if (--it->second.ref_count == 0) {
+		SDL_DestroyTexture(texture);
+		entries_.erase(it);
+		keys_.erase(key_it);
+	}
+}
+
+uint TextureCache::GetHits() const {
+	return hits_;
+}
+
+uint TextureCache::GetMisses() const {
+	return misses_;
+}
+
+size_t TextureCache::GetSize() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+void TextureCache::PrintStats() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	printf("Texture cache: %u hits, %u misses, %lu textures alive\n",
+	       hits_, misses_, entries_.size());
+}
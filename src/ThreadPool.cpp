@@ -0,0 +1,44 @@
+#include "../include/main.h"
+#include "../include/ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threads_count)
+: is_stopping_(false)
+{
+  if (threads_count == 0) {
+    threads_count = Max(1u, std::thread::hardware_concurrency());
+  }
+  for (size_t i = 0; i < threads_count; ++i) {
+    workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  cond_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+size_t ThreadPool::GetThreadsCount() const {
+  return workers_.size();
+}
+
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      cond_.wait(lock, [this]() { return is_stopping_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front());
+      jobs_.pop();
+    }
+    job();
+  }
+}
@@ -1,8 +1,17 @@
 #include <stdio.h>
+#include <string.h>
 #include <dlfcn.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <math.h>
+#include <algorithm>
+#include <fstream>
 #include "../include/Tools.h"
 #include "../include/GUIConstants.h"
 #include "../include/Plugin.h"
+#include "../include/ThreadPool.h"
+#include "../include/Sandbox.h"
 
 extern Plugin::API* kApi;
 
@@ -20,55 +29,299 @@ namespace Tool {
 
   Manager::Manager()
   : thickness_(3),
-    color_(kBlack) {}
+    color_(kBlack),
+    stroke_time_us_(0),
+    stroke_distance_(0),
+    stroke_velocity_(0),
+    cur_tool_(nullptr),
+    are_plugins_created_(false),
+    inotify_fd_(-1) {}
+
+	static bool IsSharedLibrary(const char* file_name) {
+		size_t len = strlen(file_name);
+		return len > 3 && strcmp(file_name + len - 3, ".so") == 0;
+	}
+
+	std::vector<std::string> Manager::FindPlugins() {
+		std::vector<std::string> paths;
+		DIR* dir = opendir(kPluginsDirName);
+		if (dir == nullptr) {
+			printf("Warning: can't open plugins directory %s\n", kPluginsDirName);
+			return paths;
+		}
+		for (dirent* entry = readdir(dir); entry != nullptr; entry = readdir(dir)) {
+			if (IsSharedLibrary(entry->d_name)) {
+				paths.push_back(std::string(kPluginsDirName) + "/" + entry->d_name);
+			}
+		}
+		closedir(dir);
+		// the order of the tools in the UI doesn't depend on the file system
+		std::sort(paths.begin(), paths.end());
+		return paths;
+	}
+
+	Manager::PluginLib Manager::OpenPlugin(const std::string& path) {
+		PluginLib lib = {path, nullptr, nullptr, nullptr, false, nullptr};
+		void* handle = dlopen(path.c_str(), RTLD_NOW);
+		if (handle == nullptr) {
+			printf("Warning: can't load plugin %s: %s\n", path.c_str(), dlerror());
+			return lib;
+		}
+
+		auto version = (Plugin::VersionFunction)dlsym(handle, "Version");
+		lib.create = (Plugin::CreateFunction)dlsym(handle, "Create");
+		lib.destroy = (Plugin::DestroyFunction)dlsym(handle, "Destroy");
+		if (version == nullptr || lib.create == nullptr || lib.destroy == nullptr) {
+			printf("Warning: %s doesn't export Create, Destroy and Version, skipped\n", path.c_str());
+			dlclose(handle);
+			return lib;
+		}
+		if (version() != Plugin::kVersion) {
+			printf("Warning: %s has plugin API version %u, expected %u, skipped\n",
+			       path.c_str(), version(), Plugin::kVersion);
+			dlclose(handle);
+			return lib;
+		}
+
+		auto is_thread_safe = (Plugin::IsCreateThreadSafeFunction)dlsym(handle, "IsCreateThreadSafe");
+		lib.is_create_thread_safe = is_thread_safe != nullptr && is_thread_safe();
+		lib.handle = handle;
+		return lib;
+	}
 
 	void Manager::Init() {
-		char temp[100] = {};
-		sprintf(temp, "%s/%s", kPluginsDirName, "DrawSquaresPlugin.so");
-		plugin_lib_ = dlopen(temp, RTLD_NOW);
-		assert(plugin_lib_ != nullptr);
-		Plugin::CreateFunction Create = (Plugin::CreateFunction)dlsym(plugin_lib_, "Create");
-		assert(Create != nullptr);
-		plugin_ = Create(kApi);
+		builtin_tools_.push_back(new Eraser());
+		builtin_tools_.push_back(new Pencil());
+		cur_tool_ = builtin_tools_[0];
+		WatchPluginsDir();
+
+		for (auto& path : FindPlugins()) {
+			opening_libs_.push_back(ThreadPool::GetInstance().Submit([path]() {
+				return OpenPlugin(path);
+			}));
+		}
+	}
+
+	void Manager::CreatePlugins() {
+		are_plugins_created_ = true;
+		for (auto& opening : opening_libs_) {
+			PluginLib lib = opening.get();
+			if (lib.handle != nullptr) {
+				libs_.push_back(lib);
+			}
+		}
+		opening_libs_.clear();
+
+		// plugins that allow it are created in parallel, the rest of them
+		// use the API and are created here on the UI thread
+		std::vector<std::future<Plugin::IPlugin*>> creating(libs_.size());
+		for (size_t i = 0; i < libs_.size(); ++i) {
+			if (libs_[i].is_create_thread_safe) {
+				Plugin::CreateFunction create = libs_[i].create;
+				creating[i] = ThreadPool::GetInstance().Submit([create]() {
+					return create(kApi);
+				});
+			}
+		}
+		for (size_t i = 0; i < libs_.size(); ++i) {
+			libs_[i].plugin = libs_[i].is_create_thread_safe ? creating[i].get() : libs_[i].create(kApi);
+			assert(libs_[i].plugin != nullptr);
+		}
+
+		FillLists();
+	}
+
+	void Manager::FillLists() {
+		tools_.clear();
+		filters_.clear();
+		for (auto filter : sandboxed_filters_) {
+			delete filter;
+		}
+		sandboxed_filters_.clear();
+		bool is_sandboxed = Sandbox::Host::GetInstance().IsEnabled();
+		for (auto tool : builtin_tools_) {
+			tools_.push_back(tool);
+		}
+		for (auto& lib : libs_) {
+			Plugin::Tools tools = lib.plugin->GetTools();
+			for (uint i = 0; i < tools.count; ++i) {tools_.push_back(tools.tools[i]);}
+			Plugin::Filters filters = lib.plugin->GetFilters();
+			for (uint i = 0; i < filters.count; ++i) {
+				if (is_sandboxed) {
+					sandboxed_filters_.push_back(new Sandbox::Filter(filters.filters[i], lib.path, i));
+					filters_.push_back(sandboxed_filters_.back());
+				} else {
+					filters_.push_back(filters.filters[i]);
+				}
+			}
+		}
+		if (std::find(tools_.begin(), tools_.end(), cur_tool_) == tools_.end()) {
+			cur_tool_ = builtin_tools_[0];
+		}
+	}
+
+	void Manager::WatchPluginsDir() {
+		inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (inotify_fd_ < 0 ||
+		    inotify_add_watch(inotify_fd_, kPluginsDirName, IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE) < 0) {
+			printf("Warning: plugins won't be reloaded, can't watch %s\n", kPluginsDirName);
+		}
+	}
+
+	// dlopen returns the old, still mapped image for the same path if the
+	// library couldn't be really unloaded (e.g. it has STB_GNU_UNIQUE
+	// symbols), so a reloaded plugin is opened from a fresh copy
+	static std::string CopyToTempFile(const std::string& path) {
+		char temp_path[] = "/tmp/plugin_XXXXXX.so";
+		int fd = mkstemps(temp_path, 3);
+		if (fd < 0) {
+			return "";
+		}
+		close(fd);
+		std::ifstream src(path, std::ios::binary);
+		std::ofstream dst(temp_path, std::ios::binary);
+		dst << src.rdbuf();
+		return temp_path;
+	}
 
-		Plugin::Tools tools_temp = plugin_->GetTools();
-		for (uint i = 0; i < tools_temp.count; ++i) {tools_.push_front(tools_temp.tools[i]);}
-		tools_.push_front(new Pencil());
-		tools_.push_front(new Eraser());
-		cur_tool_ = *tools_.begin();
+	void Manager::UnloadPlugin(const PluginLib& lib) {
+		Plugin::WidgetFactory* w_f = dynamic_cast<Plugin::WidgetFactory*>(kApi->GetWidgetFactory());
+		w_f->ForgetPalettesOf((const void*)lib.create);
+		lib.destroy(lib.plugin);
+		dlclose(lib.handle);
+	}
 
-		Plugin::Filters f_temp = plugin_->GetFilters();
-		for (uint i = 0; i < f_temp.count; ++i) {filters_.push_front(f_temp.filters[i]);}
+	void Manager::ReloadPlugin(const std::string& path) {
+		// the reloaded lib keeps its place, so tools and filters keep their
+		// order in the lists
+		auto it = libs_.begin();
+		while (it != libs_.end() && it->path != path) {
+			++it;
+		}
+		if (it != libs_.end()) {
+			UnloadPlugin(*it);
+		}
+		if (access(path.c_str(), F_OK) != 0) {
+			if (it != libs_.end()) {
+				libs_.erase(it);
+			}
+			printf("Plugin %s was removed\n", path.c_str());
+			return;
+		}
 
+		std::string copy_path = CopyToTempFile(path);
+		PluginLib lib = OpenPlugin(copy_path.empty() ? path : copy_path);
+		if (!copy_path.empty()) {
+			unlink(copy_path.c_str());
+		}
+		if (lib.handle == nullptr) {
+			if (it != libs_.end()) {
+				libs_.erase(it);
+			}
+			return;
+		}
+		lib.path = path;
+		lib.plugin = lib.create(kApi);
+		assert(lib.plugin != nullptr);
+		if (it != libs_.end()) {
+			*it = lib;
+		} else {
+			libs_.push_back(lib);
+		}
+		printf("Plugin %s was reloaded\n", path.c_str());
+	}
 
-		memset(temp, 0, sizeof(temp));
-		sprintf(temp, "%s/%s", kPluginsDirName, "Blur.so");
-		plugin_lib_ = dlopen(temp, RTLD_NOW);
-		assert(plugin_lib_ != nullptr);
-		Plugin::CreateFunction Create1 = (Plugin::CreateFunction)dlsym(plugin_lib_, "Create");
-		assert(Create1 != nullptr);
-		plugin_ = Create1(kApi);
+	void Manager::ReloadChangedPlugins() {
+		if (inotify_fd_ < 0) {
+			return;
+		}
 
-		Plugin::Tools tools_temp1 = plugin_->GetTools();
-		for (uint i = 0; i < tools_temp1.count; ++i) {tools_.push_front(tools_temp1.tools[i]);}
+		std::vector<std::string> changed;
+		alignas(inotify_event) char buf[4096];
+		ssize_t len = 0;
+		while ((len = read(inotify_fd_, buf, sizeof(buf))) > 0) {
+			const inotify_event* event = nullptr;
+			for (char* ptr = buf; ptr < buf + len; ptr += sizeof(inotify_event) + event->len) {
+				event = (const inotify_event*)ptr;
+				if (event->len == 0 || !IsSharedLibrary(event->name)) {
+					continue;
+				}
+				std::string path = std::string(kPluginsDirName) + "/" + event->name;
+				if (std::find(changed.begin(), changed.end(), path) == changed.end()) {
+					changed.push_back(path);
+				}
+			}
+		}
+		if (changed.empty()) {
+			return;
+		}
 
-		Plugin::Filters f_temp1 = plugin_->GetFilters();
-		for (uint i = 0; i < f_temp1.count; ++i) {filters_.push_front(f_temp1.filters[i]);}
+		if (!are_plugins_created_) {
+			CreatePlugins();
+		}
+		for (auto observer : observers_) {
+			observer->OnPluginsUnloading();
+		}
+		for (auto& path : changed) {
+			ReloadPlugin(path);
+		}
+		// the sandbox child still has the old code loaded
+		Sandbox::Host::GetInstance().Restart();
+		FillLists();
+		for (auto observer : observers_) {
+			observer->OnPluginsLoaded();
+		}
+	}
+
+	void Manager::AddObserver(PluginsObserver* observer) {
+		observers_.push_back(observer);
+	}
+
+	void Manager::DeleteObserver(PluginsObserver* observer) {
+		auto it = std::find(observers_.begin(), observers_.end(), observer);
+		assert(it != observers_.end());
+		observers_.erase(it);
 	}
 
 	Manager::~Manager() {
-		delete *tools_.begin();
-		delete *++tools_.begin();
-		Plugin::DestroyFunction Destroy = (Plugin::DestroyFunction)dlsym(plugin_lib_, "Destroy");
-		assert(Destroy != nullptr);
-		Destroy(plugin_);
+		for (auto tool : builtin_tools_) {
+			delete tool;
+		}
+		for (auto filter : sandboxed_filters_) {
+			delete filter;
+		}
+		for (auto& lib : libs_) {
+			UnloadPlugin(lib);
+		}
+		// plugins that were opened but never needed
+		for (auto& opening : opening_libs_) {
+			PluginLib lib = opening.get();
+			if (lib.handle != nullptr) {
+				dlclose(lib.handle);
+			}
+		}
+		if (inotify_fd_ >= 0) {
+			close(inotify_fd_);
+		}
 	}
 
-	void Manager::ActionBegin(Plugin::ITexture* canvas, Point2D<int> point) {
+	void Manager::ActionBegin(Plugin::ITexture* canvas, Point2D<int> point, uint64_t time_us) {
+		stroke_time_us_ = time_us;
+		stroke_distance_ = 0;
+		stroke_velocity_ = 0;
 		cur_tool_->ActionBegin(canvas, point.x, point.y);
 	}
 
-	void Manager::Action(Plugin::ITexture* canvas, Point2D<int> prev_point, Point2D<int> diff) {
+	void Manager::Action(Plugin::ITexture* canvas, Point2D<int> prev_point, Point2D<int> diff, uint64_t time_us) {
+		// weight of the newest motion, the rest smooths out mouse jitter
+		const float kVelocitySmoothing = 0.3f;
+		stroke_distance_ += sqrtf((float)(diff.x * diff.x + diff.y * diff.y));
+		if (time_us > stroke_time_us_) {
+			float velocity = stroke_distance_ * 1e6f / (float)(time_us - stroke_time_us_);
+			stroke_velocity_ += kVelocitySmoothing * (velocity - stroke_velocity_);
+			stroke_time_us_ = time_us;
+			stroke_distance_ = 0;
+		}
 		cur_tool_->Action(canvas, prev_point.x, prev_point.y, diff.x, diff.y);
 	}
 
@@ -80,16 +333,26 @@ namespace Tool {
 		return thickness_;
 	}
 
+	float Manager::GetStrokeVelocity() {
+		return stroke_velocity_;
+	}
+
 	uint Manager::GetColor() {
 		uint res = ::GetColor(color_);
 		return res;
 	}
 
 	std::list<Plugin::ITool*>& Manager::GetToolsList() {
+		if (!are_plugins_created_) {
+			CreatePlugins();
+		}
 		return tools_;
 	}
 
 	std::list<Plugin::IFilter*>& Manager::GetFiltersList() {
+		if (!are_plugins_created_) {
+			CreatePlugins();
+		}
 		return filters_;
 	}
 
@@ -123,7 +386,11 @@ namespace Tool {
   }
 
   void Pencil::Action(Plugin::ITexture* canvas, int x, int y, int dx, int dy) {
-  	canvas->DrawLine({x, y, x + dx, y + dy, manager_->GetThickness(), manager_->GetColor()});
+  	// a mouse has no pressure, fast strokes get thinner like ones of a pen
+  	const float kHalfThicknessVelocity = 2000;
+  	float scale = 1 / (1 + manager_->GetStrokeVelocity() / kHalfThicknessVelocity);
+  	uint thickness = Max(1u, (uint)(manager_->GetThickness() * scale + 0.5f));
+  	canvas->DrawLine({x, y, x + dx, y + dy, thickness, manager_->GetColor()});
   }
 
   void Pencil::ActionEnd(Plugin::ITexture* canvas, int x, int y) {}
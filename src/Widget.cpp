@@ -1,6 +1,8 @@
+#include <algorithm>
 #include <queue>
 #include <iostream>
 #include "../include/Widget.h"
+#include "../include/Render.h"
 #include "../include/FunctorQueue.h"
 #include "../include/Skins.h"
 
@@ -19,8 +21,8 @@ namespace Listener {
         auto info = event.info.mouse_motion;
         int x_diff = (int)info.new_mouse_pos.x - (int)info.old_mouse_pos.x;
         int y_diff = (int)info.new_mouse_pos.y - (int)info.old_mouse_pos.y;
-        move_func_->SetShift(Point2D<int>{x_diff, y_diff});
-        FunctorQueue::GetInstance().Push(move_func_);
+        move_func_->AddShift(Point2D<int>{x_diff, y_diff});
+        FunctorQueue::GetInstance().PushCoalesced(move_func_);
         break;
       }
 
@@ -28,13 +30,13 @@ namespace Listener {
     }
   }
 
-  BasicButtonClick::BasicButtonClick(Functor::Abstract* action_func, Widget::BasicButton* button)
-  : action_func_(action_func), button_(button) {}
+  BasicButtonClick::BasicButtonClick(Widget::BasicButton* button)
+  : button_(button) {}
 
   void BasicButtonClick::ProcessSystemEvent(const SystemEvent& event) {
     assert(event.type == SystemEvent::kMouseButtonUp);
     if (button_->IsMouseCoordinatesInBound(event.info.mouse_click.coordinate)) {
-      FunctorQueue::GetInstance().Push(action_func_);
+      FunctorQueue::GetInstance().Push(button_->action_func_);
     }
     button_->StopListeningMouseUp();
   }
@@ -70,7 +72,8 @@ namespace Widget {
 
   Abstract::Abstract(const Rectangle& position,
                      DrawFunctor::Abstract* draw_func)
-  : position_(position), draw_func_(draw_func) {}
+  : position_(position), draw_func_(draw_func), parent_(nullptr),
+    anchors_(kAnchorLeft | kAnchorTop) {}
 
   Rectangle Abstract::GetPosition() {
     return position_;
@@ -78,10 +81,30 @@ namespace Widget {
 
   void Abstract::SetPosition(const Rectangle& pos) {
     position_ = pos;
+    OnPositionChanged();
   }
 
   void Abstract::SetDrawFunc(DrawFunctor::Abstract* draw_func) {
-    draw_func_ = draw_func;
+    if (draw_func_ != draw_func) {
+      draw_func_ = draw_func;
+      Invalidate();
+    }
+  }
+
+  void Abstract::SetParent(Widget::Abstract* parent) {
+    parent_ = parent;
+  }
+
+  void Abstract::Invalidate() {
+    for (Widget::Abstract* widget = this; widget != nullptr; widget = widget->parent_) {
+      widget->DropRenderCache();
+    }
+  }
+
+  void Abstract::OnPositionChanged() {
+    if (parent_ != nullptr) {
+      parent_->OnChildMoved();
+    }
   }
 
   Point2D<int> Abstract::Move(const Point2D<int>& shift,
@@ -117,6 +140,10 @@ namespace Widget {
       real_shift.y = -temp;
     }
 
+    if ((real_shift.x != 0 || real_shift.y != 0) && parent_ != nullptr) {
+      parent_->Invalidate();
+      OnPositionChanged();
+    }
     return real_shift;
   }
 
@@ -131,6 +158,52 @@ namespace Widget {
         position_.corner.x += corner_shift.x;
       }
     }
+    OnPositionChanged();
+  }
+
+  void Abstract::SetAnchors(uint anchors) {
+    anchors_ = anchors;
+  }
+
+  void Abstract::SetSize(uint width, uint height) {
+    int width_shift = (int)width - (int)position_.width;
+    int height_shift = (int)height - (int)position_.height;
+    if (width_shift == 0 && height_shift == 0) {
+      return;
+    }
+    position_.width = width;
+    position_.height = height;
+    // render caches of the widget are recreated in the new size
+    Invalidate();
+    OnPositionChanged();
+    OnResized(width_shift, height_shift);
+  }
+
+  void Abstract::OnParentResized(int width_shift, int height_shift) {
+    // anchors don't clamp, the parent has just grown or shrunk under it
+    static const Rectangle kNoBounds = {{-(1 << 29), -(1 << 29)}, 1u << 30, 1u << 30};
+
+    Point2D<int> shift = {0, 0};
+    int width = (int)position_.width;
+    int height = (int)position_.height;
+    if (anchors_ & kAnchorRight) {
+      if (anchors_ & kAnchorLeft) {
+        width += width_shift;
+      } else {
+        shift.x = width_shift;
+      }
+    }
+    if (anchors_ & kAnchorBottom) {
+      if (anchors_ & kAnchorTop) {
+        height += height_shift;
+      } else {
+        shift.y = height_shift;
+      }
+    }
+    if (shift.x != 0 || shift.y != 0) {
+      Move(shift, kNoBounds);
+    }
+    SetSize((uint)Max(0, width), (uint)Max(0, height));
   }
 
   bool Abstract::IsMouseCoordinatesInBound(const Point2D<uint>& mouse_coord) {
@@ -159,11 +232,19 @@ namespace Widget {
   AbstractContainer::AbstractContainer(const Rectangle& position,
                                        std::initializer_list<Widget::Abstract*> children,
                                        DrawFunctor::Abstract* draw_func)
-  : Abstract(position, draw_func), children_(children) {}
+  : Abstract(position, draw_func), children_(children),
+    are_bounds_valid_(false),
+    cache_render_(nullptr), cache_(nullptr), is_cache_valid_(false)
+  {
+    for (auto child : children_) {
+      child->SetParent(this);
+    }
+  }
 
   AbstractContainer::~AbstractContainer() {
     $;
     DeleteChildren();
+    delete cache_;
     $$;
   }
 
@@ -176,71 +257,149 @@ namespace Widget {
   }
 
   void AbstractContainer::DrawChildren() {
-    if (children_.size() != 0) {
-      for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
-        (*it)->Draw();
-      }
+    for (auto it = children_.rbegin(); it != children_.rend(); ++it) {
+      (*it)->Draw();
     }
   }
 
-  std::list<Widget::Abstract*>& AbstractContainer::GetChildren() {
+  const std::vector<Widget::Abstract*>& AbstractContainer::GetChildren() {
     return children_;
   }
 
   void AbstractContainer::AddChild(Widget::Abstract* widget) {
-    children_.push_front(widget);
+    children_.insert(children_.begin(), widget);
+    are_bounds_valid_ = false;
+    widget->SetParent(this);
+    Invalidate();
   }
 
-  #define PUSH_EVENT(event_info)          \
-    for (auto child : children_) {        \
-      if (child->IsMouseCoordinatesInBound(event.info.event_info)) { \
-        child->ProcessSystemEvent(event); \
-        break;                            \
-      }                                   \
-    } 
+  bool AbstractContainer::RemoveChild(Widget::Abstract* widget) {
+    auto it = std::find(children_.begin(), children_.end(), widget);
+    if (it == children_.end()) {
+      return false;
+    }
+    children_.erase(it);
+    are_bounds_valid_ = false;
+    widget->SetParent(nullptr);
+    Invalidate();
+    OnChildRemoved(widget);
+    return true;
+  }
 
-  void AbstractContainer::PushMouseUpToChildInFocus(const SystemEvent& event) {
-    PUSH_EVENT(mouse_click.coordinate);
+  void AbstractContainer::OnChildMoved() {
+    are_bounds_valid_ = false;
   }
 
-  void AbstractContainer::PushMouseMotionToChildInFocus(const SystemEvent& event) {
-    PUSH_EVENT(mouse_motion.new_mouse_pos);
+  void AbstractContainer::OnResized(int width_shift, int height_shift) {
+    for (auto child : children_) {
+      child->OnParentResized(width_shift, height_shift);
+    }
   }
 
+  Widget::Abstract* AbstractContainer::FindChildAt(const Point2D<uint>& coordinate) {
+    if (!are_bounds_valid_) {
+      children_bounds_.resize(children_.size());
+      for (size_t i = 0; i < children_.size(); ++i) {
+        children_bounds_[i] = children_[i]->GetPosition();
+      }
+      are_bounds_valid_ = true;
+    }
+    int x = (int)coordinate.x;
+    int y = (int)coordinate.y;
+    for (size_t i = 0; i < children_bounds_.size(); ++i) {
+      const Rectangle& pos = children_bounds_[i];
+      // the same test as Abstract::IsMouseCoordinatesInBound, children
+      // with holes in them have the last word
+      if (pos.corner.x <= x && x <= pos.corner.x + (int)pos.width &&
+          pos.corner.y <= y && y <= pos.corner.y + (int)pos.height &&
+          children_[i]->IsMouseCoordinatesInBound(coordinate)) {
+        return children_[i];
+      }
+    }
+    return nullptr;
+  }
 
-  void AbstractContainer::PushMouseDownToChildInFocusAndTopHim(const SystemEvent& event) {
-    if (children_.size() == 1) {
-      PUSH_EVENT(mouse_click.coordinate);
+  void AbstractContainer::RaiseChild(Widget::Abstract* child) {
+    auto it = std::find(children_.begin(), children_.end(), child);
+    if (it == children_.end() || it == children_.begin()) {
       return;
     }
+    size_t index = it - children_.begin();
+    std::rotate(children_.begin(), it, it + 1);
+    if (are_bounds_valid_) {
+      std::rotate(children_bounds_.begin(), children_bounds_.begin() + index,
+                  children_bounds_.begin() + index + 1);
+    }
+    Invalidate();
+  }
 
-    for (auto child_it = children_.begin(); child_it != children_.end(); ++child_it) {
-      if ((*child_it)->IsMouseCoordinatesInBound(event.info.mouse_click.coordinate)) {
-        Widget::Abstract* child = *child_it;
-        child->ProcessSystemEvent(event);
-        if (child_it != children_.begin()) {
-          children_.erase(child_it);
-          children_.push_front(child);
-        }
-        break;
-      }
+  void AbstractContainer::PushMouseUpToChildInFocus(const SystemEvent& event) {
+    Widget::Abstract* child = FindChildAt(event.info.mouse_click.coordinate);
+    if (child != nullptr) {
+      child->ProcessSystemEvent(event);
     }
   }
 
-  #undef PUSH_EVENT
+  void AbstractContainer::PushMouseMotionToChildInFocus(const SystemEvent& event) {
+    Widget::Abstract* child = FindChildAt(event.info.mouse_motion.new_mouse_pos);
+    if (child != nullptr) {
+      child->ProcessSystemEvent(event);
+    }
+  }
+
+  void AbstractContainer::PushMouseDownToChildInFocusAndTopHim(const SystemEvent& event) {
+    Widget::Abstract* child = FindChildAt(event.info.mouse_click.coordinate);
+    if (child != nullptr) {
+      child->ProcessSystemEvent(event);
+      // the event may have closed the child or added new ones, so it's
+      // looked up again
+      RaiseChild(child);
+    }
+  }
+
+  void AbstractContainer::EnableRenderCache(Render* render) {
+    cache_render_ = render;
+    is_cache_valid_ = false;
+  }
+
+  void AbstractContainer::DropRenderCache() {
+    is_cache_valid_ = false;
+  }
 
   void AbstractContainer::Draw() {
-    this->Abstract::Draw();
-    DrawChildren();
+    if (cache_render_ == nullptr) {
+      this->Abstract::Draw();
+      DrawChildren();
+      return;
+    }
+
+    if (!is_cache_valid_) {
+      if (cache_ == nullptr || cache_->GetWidth() != position_.width ||
+                               cache_->GetHeight() != position_.height) {
+        delete cache_;
+        cache_ = new Texture(position_.width, position_.height, cache_render_);
+      }
+      cache_render_->PushTarget(cache_, position_.corner);
+      cache_->Clear();
+      this->Abstract::Draw();
+      DrawChildren();
+      cache_render_->PopTarget();
+      is_cache_valid_ = true;
+    }
+    cache_->Draw(nullptr, &position_);
   }
 
   Point2D<int> AbstractContainer::Move(const Point2D<int>& shift,
                                        const Rectangle& bounds) {
     Point2D<int> real_shift = this->Abstract::Move(shift, bounds);
     if (!(real_shift.x == 0 && real_shift.y == 0)) {
+      // the whole subtree moves together, so the cached picture of it
+      // stays the same
+      bool was_cache_valid = is_cache_valid_;
       for (auto child : children_) {
         child->Move(real_shift, bounds);
       }
+      is_cache_valid_ = was_cache_valid;
     }
 
     return real_shift;
@@ -255,57 +414,96 @@ namespace Widget {
   MainWindow::MainWindow(const Rectangle& position,
                          std::initializer_list<Widget::Abstract*> children,
                          DrawFunctor::Abstract* draw_func)
-  : AbstractContainer(position, children, draw_func) {
-    listener_table_[SystemEvent::kMouseButtonUp];
-    listener_table_[SystemEvent::kMouseButtonDown];
-    listener_table_[SystemEvent::kMouseMotion];
-  }
+  : AbstractContainer(position, children, draw_func),
+    dispatch_stamp_(0),
+    keyboard_focus_(nullptr) {}
 
   void MainWindow::AddListener(SystemEvent::Type event_type, Listener::Abstract* listener) {
-    auto it = listener_table_.find(event_type);
-    assert(it != listener_table_.end());
-    listener_table_[event_type].insert(listener);
+    assert(event_type < SystemEvent::kUndefined);
+    auto& listeners = listener_table_[event_type];
+    assert(std::find(listeners.begin(), listeners.end(), listener) == listeners.end());
+    listeners.push_back(listener);
+    ++listener->listened_types_count_;
   }
 
   void MainWindow::DeleteListener(SystemEvent::Type event_type, Listener::Abstract* listener) {
-    auto it = listener_table_.find(event_type);
-    assert(it != listener_table_.end());
-    auto& set = listener_table_[event_type];
-    size_t sz = listener_table_[event_type].size();
-    if (set.find(listener) == set.end()) {
-      assert(0);
-    } else {
-      set.erase(listener);
-      assert(listener_table_[event_type].size() == sz - 1);
+    assert(event_type < SystemEvent::kUndefined);
+    auto& listeners = listener_table_[event_type];
+    auto it = std::find(listeners.begin(), listeners.end(), listener);
+    assert(it != listeners.end());
+    listeners.erase(it);
+    --listener->listened_types_count_;
+  }
+
+  void MainWindow::DeleteListener(Listener::Abstract* listener) {
+    for (auto& listeners : listener_table_) {
+      auto it = std::find(listeners.begin(), listeners.end(), listener);
+      if (it != listeners.end()) {
+        listeners.erase(it);
+        --listener->listened_types_count_;
+      }
     }
+    assert(!listener->IsListening());
+  }
+
+  void MainWindow::SetKeyboardFocus(Widget::Abstract* child) {
+    assert(child == nullptr || std::find(children_.begin(), children_.end(), child) != children_.end());
+    keyboard_focus_ = child;
   }
 
-  bool MainWindow::IsListenerProcessed(Listener::Abstract* listener) {
-    return processed_listeners_.find(listener) != processed_listeners_.end();
+  bool MainWindow::ProcessKey(const SystemEvent& event) {
+    if (keyboard_focus_ != nullptr && keyboard_focus_->ProcessKey(event)) {
+      return true;
+    }
+    // a held key would apply a filter over and over
+    const KeyboardKeyClickInfo& key = event.info.keyboard_key_click;
+    if (event.type != SystemEvent::kKeyboardKeyDown || key.is_repeat) {
+      return false;
+    }
+    Functor::Abstract* func = shortcuts_.Find(key);
+    if (func == nullptr) {
+      return false;
+    }
+    FunctorQueue::GetInstance().Push(func);
+    return true;
+  }
+
+  ShortcutTable& MainWindow::GetShortcuts() {
+    return shortcuts_;
+  }
+
+  void MainWindow::OnChildRemoved(Widget::Abstract* child) {
+    if (child != keyboard_focus_) {
+      return;
+    }
+    keyboard_focus_ = nullptr;
+    for (auto other : children_) {
+      if (other->IsKeyboardFocusable()) {
+        keyboard_focus_ = other;
+        break;
+      }
+    }
   }
 
   void MainWindow::SendEventToListeners(const SystemEvent& event) {
     $;
-    assert(listener_table_.find(event.type) != listener_table_.end());
+    assert(event.type < SystemEvent::kUndefined);
+    auto& listeners = listener_table_[event.type];
+    ++dispatch_stamp_;
+    // listeners add and delete listeners, so the search starts over after
+    // each call, the stamp tells which of them were already called
     bool is_end = false;
     while (!is_end) {
-      auto& listeners = listener_table_[event.type];
-      auto it = listeners.begin();
-
-      for (; it != listeners.end(); ++it) {
-        if (!IsListenerProcessed(*it)) {
-          processed_listeners_.insert(*it);
-          (*it)->ProcessSystemEvent(event);
+      is_end = true;
+      for (auto listener : listeners) {
+        if (listener->dispatch_stamp_ != dispatch_stamp_) {
+          listener->dispatch_stamp_ = dispatch_stamp_;
+          listener->ProcessSystemEvent(event);
+          is_end = false;
           break;
         }
       }
-
-      if (it == listeners.end()) {
-        is_end = true;
-      }
     }
-
-    processed_listeners_.clear();
     $$;
   }
 
@@ -317,19 +515,34 @@ namespace Widget {
         PushMouseUpToChildInFocus(event);
         break;
 
-      case SystemEvent::kMouseButtonDown:
+      case SystemEvent::kMouseButtonDown: {
         SendEventToListeners(event);
+        Widget::Abstract* child = FindChildAt(event.info.mouse_click.coordinate);
+        if (child != nullptr && child->IsKeyboardFocusable()) {
+          keyboard_focus_ = child;
+        }
         PushMouseDownToChildInFocusAndTopHim(event);
         break;
+      }
 
       case SystemEvent::kMouseMotion:
         SendEventToListeners(event);
         PushMouseMotionToChildInFocus(event);
         break;
 
-      case SystemEvent::kWindowResize:
+      case SystemEvent::kKeyboardKeyDown:
+      case SystemEvent::kKeyboardKeyUp:
+        SendEventToListeners(event);
+        ProcessKey(event);
         break;
 
+      case SystemEvent::kWindowResize: {
+        // stale resizes of a frame are already dropped by the EventPump
+        auto info = event.info.window_resize;
+        SetSize(info.new_width, info.new_height);
+        break;
+      }
+
       default:
         printf("ERROR: event type = %d\n", event.type);
         assert(0);
@@ -386,7 +599,7 @@ namespace Widget {
   // -----------------------------------------------------
   // -----------------------------------------------------
   Drag::~Drag() {
-    if (drag_listener_ != nullptr) {
+    if (drag_listener_.IsListening()) {
       FinishDrag();
     }
   }
@@ -399,19 +612,16 @@ namespace Widget {
   : AbstractContainer(position, children, draw_func),
     main_window_(main_window),
     move_func_(move_func),
-    drag_listener_(nullptr) {}
+    drag_listener_(move_func, this) {}
 
   void Drag::StartDrag() {
-    drag_listener_ = new Listener::Drag(move_func_, this);
-    main_window_->AddListener(SystemEvent::kMouseMotion, drag_listener_);
-    main_window_->AddListener(SystemEvent::kMouseButtonUp, drag_listener_);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &drag_listener_);
+    main_window_->AddListener(SystemEvent::kMouseButtonUp, &drag_listener_);
   }
 
   void Drag::FinishDrag() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, drag_listener_);
-    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, drag_listener_);
-    delete drag_listener_;
-    drag_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &drag_listener_);
+    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, &drag_listener_);
   }
 
   void Drag::ProcessSystemEvent(const SystemEvent& event) {
@@ -422,22 +632,17 @@ namespace Widget {
       }
 
       case SystemEvent::kMouseButtonDown: {
-        bool was_event_accepted = false;
-        for (auto child : children_) {
-          if (child->IsMouseCoordinatesInBound(event.info.mouse_click.coordinate)) {
-            was_event_accepted = true;
-            child->ProcessSystemEvent(event);
-            break;
-          }
-        }
-        if (!was_event_accepted) {
+        Widget::Abstract* child = FindChildAt(event.info.mouse_click.coordinate);
+        if (child != nullptr) {
+          child->ProcessSystemEvent(event);
+        } else {
           StartDrag();
         }
         break;
       }
 
       case SystemEvent::kMouseMotion: {
-        if (drag_listener_ == nullptr) {
+        if (!drag_listener_.IsListening()) {
           PushMouseMotionToChildInFocus(event);
         }
         break;
@@ -455,13 +660,11 @@ namespace Widget {
   // -----------------------------------------------------
   // -----------------------------------------------------
   BasicButton::~BasicButton() {
-    if (click_listener_ != nullptr) {
-      main_window_->DeleteListener(SystemEvent::kMouseButtonUp, click_listener_);
-      delete click_listener_;
+    if (click_listener_.IsListening()) {
+      main_window_->DeleteListener(&click_listener_);
     }
-    if (hover_listener_ != nullptr) {
-      main_window_->DeleteListener(SystemEvent::kMouseMotion, hover_listener_);
-      delete hover_listener_;
+    if (hover_listener_.IsListening()) {
+      main_window_->DeleteListener(&hover_listener_);
     }
   }
 
@@ -473,44 +676,38 @@ namespace Widget {
     main_window_(main_window),
     action_func_(action_func),
     draw_funcs_(draw_funcs),
-    click_listener_(nullptr),
-    hover_listener_(nullptr) {}
+    click_listener_(this),
+    hover_listener_(this) {}
 
   ButtonDrawFunctors BasicButton::GetDrawFuncs() {
     return draw_funcs_;
   }
 
   void BasicButton::StartListeningMouseUp() {
-    click_listener_ = new Listener::BasicButtonClick(action_func_, this);
-    main_window_->AddListener(SystemEvent::kMouseButtonUp, click_listener_);
+    main_window_->AddListener(SystemEvent::kMouseButtonUp, &click_listener_);
     if (draw_funcs_.draw_func_click != nullptr) {
-      draw_func_ = draw_funcs_.draw_func_click;
+      SetDrawFunc(draw_funcs_.draw_func_click);
     }
   }
 
   void BasicButton::StartListeningMouseMotion() {
-    hover_listener_ = new Listener::BasicButtonHover(this);
-    main_window_->AddListener(SystemEvent::kMouseMotion, hover_listener_);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &hover_listener_);
     if (draw_funcs_.draw_func_hover != nullptr) {
-      draw_func_ = draw_funcs_.draw_func_hover;
+      SetDrawFunc(draw_funcs_.draw_func_hover);
     }
   }
 
   void BasicButton::StopListeningMouseUp() {
-    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, click_listener_);
-    delete click_listener_;
-    click_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseButtonUp, &click_listener_);
     if (draw_func_ == draw_funcs_.draw_func_click) {
-      draw_func_ = draw_funcs_.draw_func_main;
+      SetDrawFunc(draw_funcs_.draw_func_main);
     }
   }
 
   void BasicButton::StopListeningMouseMotion() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, hover_listener_);
-    delete hover_listener_;
-    hover_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &hover_listener_);
     if (draw_func_ == draw_funcs_.draw_func_hover) {
-      draw_func_ = draw_funcs_.draw_func_main;
+      SetDrawFunc(draw_funcs_.draw_func_main);
     }
   }
 
@@ -528,8 +725,8 @@ namespace Widget {
       }
 
       case SystemEvent::kMouseMotion: {
-        if (hover_listener_ == nullptr) {
-          if (click_listener_ == nullptr) {
+        if (!hover_listener_.IsListening()) {
+          if (!click_listener_.IsListening()) {
            StartListeningMouseMotion();
           }
         } // else it's already processed by listener
@@ -555,30 +752,26 @@ namespace Widget {
     main_window_(main_window),
     action_func_(action_func),
     draw_funcs_(draw_funcs),
-    hover_listener_(nullptr),
+    hover_listener_(this),
     is_in_click_state_(false) {}
 
   ButtonOnPress::~ButtonOnPress() {
-    if (hover_listener_ != nullptr) {
-      main_window_->DeleteListener(SystemEvent::kMouseButtonUp, hover_listener_);
-      delete hover_listener_;
+    if (hover_listener_.IsListening()) {
+      main_window_->DeleteListener(&hover_listener_);
     }
   }
 
   void ButtonOnPress::StartListeningMouseMotion() {
-    hover_listener_ = new Listener::ButtonOnPress(this);
-    main_window_->AddListener(SystemEvent::kMouseMotion, hover_listener_);
+    main_window_->AddListener(SystemEvent::kMouseMotion, &hover_listener_);
     if (draw_funcs_.draw_func_hover != nullptr) {
-      draw_func_ = draw_funcs_.draw_func_hover;
+      SetDrawFunc(draw_funcs_.draw_func_hover);
     }
   }
 
   void ButtonOnPress::StopListeningMouseMotion() {
-    main_window_->DeleteListener(SystemEvent::kMouseMotion, hover_listener_);
-    delete hover_listener_;
-    hover_listener_ = nullptr;
+    main_window_->DeleteListener(SystemEvent::kMouseMotion, &hover_listener_);
     if (draw_func_ == draw_funcs_.draw_func_hover) {
-      draw_func_ = draw_funcs_.draw_func_main;
+      SetDrawFunc(draw_funcs_.draw_func_main);
     }
   }
 
@@ -588,7 +781,7 @@ namespace Widget {
         is_in_click_state_ = true;
         if (action_func_ != nullptr) {
           if (draw_funcs_.draw_func_click != nullptr) {
-            draw_func_ = draw_funcs_.draw_func_click;
+            SetDrawFunc(draw_funcs_.draw_func_click);
           }
           FunctorQueue::GetInstance().Push(action_func_);
         }
@@ -596,7 +789,7 @@ namespace Widget {
       }
 
       case SystemEvent::kMouseMotion: {
-        if (hover_listener_ == nullptr) {
+        if (!hover_listener_.IsListening()) {
           if (!is_in_click_state_) {
            StartListeningMouseMotion();
           } // else it's in a click state and no need to do that
@@ -607,7 +800,7 @@ namespace Widget {
   }
 
   void ButtonOnPress::StopTheClick() {
-    draw_func_ = draw_funcs_.draw_func_main;
+    SetDrawFunc(draw_funcs_.draw_func_main);
     is_in_click_state_ = false;
   }
 }
@@ -793,6 +986,8 @@ namespace UserWidget {
     text_ = new ::Texture(text, render_, kWhite);
     position_.width = text_->GetWidth() + 2 * kTextWidthOfs;
     draw_text_->SetTexture(text_);
+    Invalidate();
+    OnPositionChanged();
   }
 
   Label::~Label() {
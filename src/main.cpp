@@ -2,6 +2,9 @@
 #include "../include/Render.h"
 #include "../include/GLWindow.h"
 #include "../include/App.h"
+#include "../include/Sandbox.h"
+#include "../include/Batch.h"
+#include "../include/SystemEvents.h"
 
 Color GetColor(uint color) {
   unsigned char arr[4] = {};
@@ -21,11 +24,31 @@ uint GetColor(Color color) {
   return res;
 }
 
-int main() {
+int main(int argc, char** argv) {
+  // sandbox child runs filters only, it needs neither a window nor traces
+  if (argc == 3 && strcmp(argv[1], Sandbox::kChildFlag) == 0) {
+    return Sandbox::RunChild(atoi(argv[2]));
+  }
   InitStackTrace({SIGSEGV, SIGABRT}, 100);
+  if (argc >= 2 && strcmp(argv[1], Batch::kFlag) == 0) {
+    int exit_code = Batch::Run(argc - 2, argv + 2);
+    FreeStackTrace();
+    return exit_code;
+  }
+
+  std::vector<std::string> file_paths;
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], Sandbox::kEnableFlag) == 0) {
+      Sandbox::Host::GetInstance().Enable();
+    } else if (strcmp(argv[i], EventPump::kRecordFlag) == 0 && i + 1 < argc) {
+      EventPump::GetInstance().StartRecording(argv[++i]);
+    } else {
+      file_paths.push_back(argv[i]);
+    }
+  }
   srand(time(NULL));
   GLWindow window(1848, 1016);
   Render render(window);
-  RunApp(&window, &render);
+  RunApp(&window, &render, file_paths);
   FreeStackTrace();
 }
\ No newline at end of file